@@ -0,0 +1,8 @@
+#!/bin/bash
+
+export ROOTSYS=/cvmfs/sft.cern.ch/lcg/app/releases/ROOT/6.20.08/x86_64-centos7-gcc48-opt
+source $ROOTSYS/bin/thisroot.sh
+
+# Daemon on localhost:$1 (default 9090), stop it with: query.sh $1 shutdown
+cd "$(dirname "$0")"
+root -b -q 'FluxQuery.C('${1:-9090}')'
@@ -0,0 +1,12 @@
+#!/bin/bash
+
+# Send one query to the FluxQuery daemon and print the answer
+# Usage: query.sh <port> "flux <t0> <t1> [rebin=<n> | edges=<R0>,<R1>,...] [corrections=<mask>]"
+
+exec 3<>/dev/tcp/127.0.0.1/$1 || exit 1
+echo "$2" >&3
+while IFS= read -r line <&3; do
+    [ "$line" = "end" ] && break
+    echo "$line"
+done
+exec 3<&-
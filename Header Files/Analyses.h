@@ -0,0 +1,588 @@
+#ifndef __Analyses_h__
+#define __Analyses_h__
+
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1F.h"
+#include "TNamed.h"
+#include "TString.h"
+#include "TTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "Ntp.h"
+#include "Sampling.h"
+#include "ChangePoint.h"
+
+using namespace std;
+
+/** \file Analyses.h
+Analyses that share one pass over the Compact stream in ZoneLooper.
+Every registered analysis keeps its own accumulators and declares the NtpCompact columns it reads;
+the loop only enables the union of those columns, decodes each entry once and hands it to all analyses.
+Every entry is first seen by processCheap() with only the cheapColumns() read; processEvent() (and the
+remaining columns, see PhasedReader.h) only follow if processCheap() returned true. processCheap() must
+therefore return true whenever processEvent() could fill anything.
+*/
+
+/** \class ZoneEvent
+One decoded Compact entry, as seen by the analyses.
+*/
+class ZoneEvent {
+
+ public:
+
+  NtpCompact *compact;  ///< Compact record (only the requested columns are filled)
+  NtpSHeader *header;   ///< Short header (run, event, utime)
+  float       cutOff;   ///< Max geomagnetic cut-off of the event second, cf[0][3][1] [GV]
+
+};
+
+/** \class ZoneAnalysis
+Base class of an analysis plugin.
+*/
+class ZoneAnalysis {
+
+ public:
+
+  TString         name;          ///< Output directory, empty for the top level of the zone file
+  int             binNumber;     ///< Number of rigidity bins
+  const double   *binEdges;      ///< Rigidity bin edges [GV]
+  vector<double>  binCentres;    ///< Rigidity bin centres [GV]
+  double          cutOffFactor;  ///< Safety factor on the geomagnetic cut-off
+  vector<TH1F*>   histograms;    ///< Accumulators, written in this order
+
+  ZoneAnalysis(TString analysisName, int bins, const double *edges, double factor) {
+    name         = analysisName;
+    binNumber    = bins;
+    binEdges     = edges;
+    cutOffFactor = factor;
+    for (int i=0; i < binNumber; i++) binCentres.push_back((binEdges[i + 1] + binEdges[i]) / 2);
+  }
+  virtual ~ZoneAnalysis(){}
+
+  //! NtpCompact members read in processCheap() and processEvent()
+  virtual vector<TString> columns() = 0;
+  //! NtpCompact members read in processCheap() (subset of columns())
+  virtual vector<TString> cheapColumns() { return {}; }
+  //! Called once per RTI second (exposure)
+  virtual void processRTI(const RTIInfo *rti) {}
+  //! Called once per Compact entry, returns false if processEvent() would fill nothing
+  virtual bool processCheap(const ZoneEvent &event) { return true; }
+  //! Called for the Compact entries kept by processCheap()
+  virtual void processEvent(const ZoneEvent &event) = 0;
+
+  //! New detached accumulator with the common rigidity binning
+  TH1F *book(const char *histName, const char *histTitle) {
+    TH1F *histogram = new TH1F(histName, histTitle, binNumber, binEdges);
+    histogram->SetDirectory(0);
+    histograms.push_back(histogram);
+    return histogram;
+  }
+
+  //! Add the livetime of this second to every bin above the cut-off
+  void addExposure(TH1F *exposure, const RTIInfo *rti) {
+    for (int j=0; j < binNumber; j++) {
+      if (binCentres[j] > cutOffFactor * rti->cf[0][3][1]) {
+        exposure->SetBinContent(j + 1, exposure->GetBinContent(j + 1) + rti->lf);
+      }
+    }
+  }
+
+  //! Quick-look runs: scale the counts of the sampled files to the whole exposure (exposureTime is complete already)
+  void scaleSample(const double *weights, TString label) {
+    for (auto histogram : histograms) {
+      if (TString(histogram->GetName()) == "exposureTime") continue;
+      scaleCounts(histogram, weights);
+      histogram->SetTitle(Form("%s [%s]", histogram->GetTitle(), label.Data()));
+    }
+  }
+
+  //! Write the accumulators into the analysis directory of the file
+  virtual void write(TFile *f) {
+    TDirectory *directory = f;
+    if (name.Length() > 0) {
+      directory = f->mkdir(name);
+    }
+    directory->cd();
+    for (auto histogram : histograms) {
+      histogram->Write();
+    }
+    f->cd();
+  }
+
+};
+
+/** \class ProtonAnalysis
+The proton selection of the flux analysis, writes the accumulators read by GraphLooper at the top level.
+*/
+class ProtonAnalysis : public ZoneAnalysis {
+
+ public:
+
+  TH1F *exposureTime, *eventsDetected, *eventsSelected, *triggersPhysical, *triggersBias;
+  TH1F *baseTracker, *baseTOF, *cutParticle, *cutBeta, *cutChiSquared, *cutInnerLayer;
+
+  unsigned short word        = 0;      ///< selectionWord() of the current entry, if wordCurrent
+  bool           wordCurrent = false;  ///< processEvent() ran for the current entry (reused by RateMonitor)
+
+  ProtonAnalysis(int bins, const double *edges, double factor) : ZoneAnalysis("", bins, edges, factor) {
+    exposureTime     = book("exposureTime", "Exposure Time per Rigidity Bin");
+    eventsDetected   = book("eventsDetected", "Detected Events per Rigidity Bin");
+    eventsSelected   = book("eventsSelected", "Selected Proton Events per Rigidity Bin");
+    triggersPhysical = book("triggersPhysical", "Proton Physical Triggers per Rigidity Bin");
+    triggersBias     = book("triggersBias", "Proton Bias Triggers per Rigidity Bin");
+    baseTracker      = book("baseTracker", "Proton Tracker Base");
+    baseTOF          = book("baseTOF", "Proton TOF Base");
+    cutParticle      = book("cutParticle", "Proton Particle Cut");
+    cutBeta          = book("cutBeta", "Proton Beta Cut");
+    cutChiSquared    = book("cutChiSquared", "Proton Chi Squared Cut");
+    cutInnerLayer    = book("cutInnerLayer", "Proton Inner Layer Cut");
+  }
+
+  vector<TString> columns() {
+    return { "trk_rig", "sublvl1", "trigpatt", "status", "tof_beta", "trk_chisqn", "trk_q_inn", "tof_q_lay" };
+  }
+
+  vector<TString> cheapColumns() {
+    return { "trk_rig", "trigpatt" };
+  }
+
+  void processRTI(const RTIInfo *rti) {
+    // Exposure() --> Get total livetime as a function of rigidity
+    addExposure(exposureTime, rti);
+  }
+
+  bool processCheap(const ZoneEvent &event) {
+
+    const NtpCompact *c = event.compact;
+    wordCurrent = false;
+
+    // RigBinner() --> Bin events as a function of rigidity
+    eventsDetected->Fill(c->trk_rig[0]);
+
+    // Every other histogram needs the rigidity range and trigpatt & 0x02 (all masks hold bit 1, the
+    // 0x7B fills need boolPhysical or boolUnphysical)
+    bool boolRigidity = (c->trk_rig[0] > binEdges[0]) && (c->trk_rig[0] <= binEdges[binNumber]);
+    return boolRigidity && ((c->trigpatt & 0x02) != 0);
+
+  }
+
+  void processEvent(const ZoneEvent &event) {
+    word        = selectionWord(event);
+    wordCurrent = true;
+    fillSelection(word, event.compact->trk_rig[0]);
+  }
+
+  //! Selection bits of an entry: boolBit (bits 0-6), TOF charge (bit 7) and bias trigger (bit 8)
+  /** The cut values are also listed in SelectionSidecar::selectionCuts(), change both together. */
+  unsigned short selectionWord(const ZoneEvent &event) {
+
+    const NtpCompact *c = event.compact;
+
+    // List of boolean cuts
+    // Geomagnetic cut-off
+    bool boolCutOff     = c->trk_rig[0] > cutOffFactor * event.cutOff;
+    // Within our rigidity range
+    bool boolRigidity   = (c->trk_rig[0] > binEdges[0]) && (c->trk_rig[0] <= binEdges[binNumber]);
+    // Correct trigger pattern
+    bool boolTriggers   = ((c->sublvl1 & 0x3E) != 0) && ((c->trigpatt & 0x02) != 0);
+    // Particle-like events
+    bool boolParticle   = c->status % 10 == 1;
+    // TOF Beta selection
+    bool boolBeta       = c->tof_beta > 0.3;
+    // Chi-Squared selection
+    bool boolChiSquared = (c->trk_chisqn[0][0] < 10) && (c->trk_chisqn[0][1] < 10) && (c->trk_chisqn[0][0] > 0) && (c->trk_chisqn[0][1] > 0);
+    // Inner Layer selection
+    bool boolInnerLayer = (c->trk_q_inn > 0.80) && (c->trk_q_inn < 1.30);
+
+    // Selection parameter
+    int boolBit = boolCutOff + (boolRigidity << 1) + (boolTriggers << 2) + (boolParticle << 3) +
+                  (boolBeta << 4) + (boolChiSquared << 5) + (boolInnerLayer << 6);
+
+    // Additional TOF charge cuts (to replace TRK charge cuts)
+    bool boolTOFCharge  = (c->tof_q_lay[0] > 0.8) && (c->tof_q_lay[0] < 1.5);
+    // Bias trigger (physical triggers are boolTriggers)
+    bool boolUnphysical = ((c->sublvl1 & 0x3E) == 0) && ((c->trigpatt & 0x02) != 0);
+
+    return boolBit + (boolTOFCharge << 7) + (boolUnphysical << 8);
+
+  }
+
+  //! Fill every histogram but eventsDetected from the selection bits (also replays selection sidecars)
+  void fillSelection(unsigned short word, float rigidity) {
+
+    int  boolBit        = word & 0x7F;
+    bool boolTOFCharge  = (word & 0x80) != 0;
+    bool boolPhysical   = (word & 0x04) != 0;
+    bool boolUnphysical = (word & 0x100) != 0;
+
+    // RigBinner() --> Bin events as a function of rigidity (eventsDetected in processCheap())
+    if ((boolBit & 0x7F) == 0x7F) { // 0x7F = 0b01111111 (All)
+      eventsSelected->Fill(rigidity);
+    }
+
+    // TrigEff(): Data --> Trigger efficiency as a function fo rigidity
+    if ((boolBit & 0x7B) == 0x7B) { // 0x7B = 0b01111011 (All but Triggers)
+      if (boolPhysical) {
+        triggersPhysical->Fill(rigidity);
+      }
+      if (boolUnphysical) {
+        triggersBias->Fill(rigidity);
+      }
+    }
+
+    // SelEff(): Data --> Selection efficiency of applied cuts as a function of rigidity
+    // TRK base histogram
+    if ((boolBit & 0x17) == 0x17) { // 0x17 = 0b00010111 (Beta, Triggers, Rigidity, CutOff)
+      if (boolTOFCharge) {
+        baseTracker->Fill(rigidity);
+      }
+    }
+
+    // TOF base histogram
+    if ((boolBit & 0x6F) == 0x6F) { // 0x6F = 0b01101111 (All but Beta)
+      baseTOF->Fill(rigidity);
+    }
+
+    // Particle-like selection (TRK base)
+    if ((boolBit & 0x3E) == 0x3E) { // 0x3E = 0b00011111 (All but InnerLayer, ChiSquared)
+      if (boolTOFCharge) {
+        cutParticle->Fill(rigidity);
+      }
+    }
+
+    // Beta selection (TOF base)
+    if ((boolBit & 0x7F) == 0x7F) { // 0x7F = 0b01111111 (All)
+      cutBeta->Fill(rigidity);
+    }
+
+    // Chi-Squared selection (TRK base)
+    if ((boolBit & 0x37) == 0x37) { // 0x37 = 0b00110111 (All but Innerlayer, Particle)
+      if (boolTOFCharge) {
+        cutChiSquared->Fill(rigidity);
+      }
+    }
+
+    // Inner Layer selection (TRK base w/o TOFCharge cut)
+    if ((boolBit & 0x57) == 0x57) { // 0x57 = 0b01010111 (All but Particle, ChiSquared)
+      cutInnerLayer->Fill(rigidity);
+    }
+
+  }
+
+};
+
+/** \class ChargeAnalysis
+Single-species selection on the signed rigidity and a charge window, sharing the proton quality cuts.
+Used for helium (inner tracker charge ~2), antiproton candidates (negative rigidity) and a proton
+selection on the upper TOF charge instead of the inner tracker charge.
+*/
+class ChargeAnalysis : public ZoneAnalysis {
+
+ public:
+
+  int   sign;          ///< +1 selects positive, -1 negative rigidity (|R| is binned)
+  bool  useTOFCharge;  ///< Charge window on tof_q_lay[0] instead of trk_q_inn
+  float chargeMinimum; ///< Lower edge of the charge window
+  float chargeMaximum; ///< Upper edge of the charge window
+
+  TH1F *exposureTime, *eventsDetected, *eventsSelected, *triggersPhysical, *triggersBias;
+
+  ChargeAnalysis(TString analysisName, int rigiditySign, bool tofCharge, float qMin, float qMax,
+                 int bins, const double *edges, double factor) : ZoneAnalysis(analysisName, bins, edges, factor) {
+    sign          = rigiditySign;
+    useTOFCharge  = tofCharge;
+    chargeMinimum = qMin;
+    chargeMaximum = qMax;
+    exposureTime     = book("exposureTime", Form("%s Exposure Time per Rigidity Bin", name.Data()));
+    eventsDetected   = book("eventsDetected", Form("%s Detected Events per Rigidity Bin", name.Data()));
+    eventsSelected   = book("eventsSelected", Form("%s Selected Events per Rigidity Bin", name.Data()));
+    triggersPhysical = book("triggersPhysical", Form("%s Physical Triggers per Rigidity Bin", name.Data()));
+    triggersBias     = book("triggersBias", Form("%s Bias Triggers per Rigidity Bin", name.Data()));
+  }
+
+  vector<TString> columns() {
+    return { "trk_rig", "sublvl1", "trigpatt", "status", "tof_beta", "trk_chisqn", useTOFCharge ? "tof_q_lay" : "trk_q_inn" };
+  }
+
+  vector<TString> cheapColumns() {
+    return { "trk_rig", "trigpatt", "status" };
+  }
+
+  void processRTI(const RTIInfo *rti) {
+    addExposure(exposureTime, rti);
+  }
+
+  bool processCheap(const ZoneEvent &event) {
+
+    const NtpCompact *c = event.compact;
+
+    // Binned in |R| of the requested sign
+    if (c->trk_rig[0] * sign <= 0) {
+      return false;
+    }
+    float rigidity = fabs(c->trk_rig[0]);
+    eventsDetected->Fill(rigidity);
+
+    // Both masks hold the cut-off, rigidity and particle bits, both trigger fills need trigpatt & 0x02
+    bool boolCutOff   = rigidity > cutOffFactor * event.cutOff;
+    bool boolRigidity = (rigidity > binEdges[0]) && (rigidity <= binEdges[binNumber]);
+    bool boolParticle = c->status % 10 == 1;
+    return boolCutOff && boolRigidity && boolParticle && ((c->trigpatt & 0x02) != 0);
+
+  }
+
+  void processEvent(const ZoneEvent &event) {
+
+    const NtpCompact *c = event.compact;
+
+    // Only called for the requested sign (see processCheap())
+    float rigidity = fabs(c->trk_rig[0]);
+    float charge   = useTOFCharge ? c->tof_q_lay[0] : c->trk_q_inn;
+
+    bool boolCutOff     = rigidity > cutOffFactor * event.cutOff;
+    bool boolRigidity   = (rigidity > binEdges[0]) && (rigidity <= binEdges[binNumber]);
+    bool boolTriggers   = ((c->sublvl1 & 0x3E) != 0) && ((c->trigpatt & 0x02) != 0);
+    bool boolParticle   = c->status % 10 == 1;
+    bool boolBeta       = c->tof_beta > 0.3;
+    bool boolChiSquared = (c->trk_chisqn[0][0] < 10) && (c->trk_chisqn[0][1] < 10) && (c->trk_chisqn[0][0] > 0) && (c->trk_chisqn[0][1] > 0);
+    bool boolCharge     = (charge > chargeMinimum) && (charge < chargeMaximum);
+
+    int boolBit = boolCutOff + (boolRigidity << 1) + (boolTriggers << 2) + (boolParticle << 3) +
+                  (boolBeta << 4) + (boolChiSquared << 5) + (boolCharge << 6);
+
+    if ((boolBit & 0x7F) == 0x7F) { // All
+      eventsSelected->Fill(rigidity);
+    }
+
+    bool boolUnphysical = ((c->sublvl1 & 0x3E) == 0) && ((c->trigpatt & 0x02) != 0);
+    if ((boolBit & 0x7B) == 0x7B) { // All but Triggers
+      if (boolTriggers) {
+        triggersPhysical->Fill(rigidity);
+      }
+      if (boolUnphysical) {
+        triggersBias->Fill(rigidity);
+      }
+    }
+
+  }
+
+};
+
+/** \class RateMonitor
+Selected proton counts per RTI second in four coarse rigidity bands, with a streaming change-point search per band.
+A band counts in a second if its lowest bin has exposure (see addExposure()) and the second holds Compact
+entries (seconds of files that were not read, e.g. in quick-look runs, are not zero rates). The state is
+13 bytes per second. The Compact chain is read in time order, so a second is complete as soon as an entry of
+a later second arrives; it is then fed to the RateChangeDetector of every band (see ChangePoint.h) within the
+event loop. The RateSeries tree has a row per second with entries, the RateAlerts tree the rises and falls.
+The selection word is taken from the registered ProtonAnalysis when it already computed it for the entry; without
+one the monitor gets a private ProtonAnalysis. Either is set by the looper before the columns are asked for.
+*/
+class RateMonitor : public ZoneAnalysis {
+
+ public:
+
+  static const int bandNumber = 4;
+  int              bandBins[bandNumber + 1] = { 0, 6, 13, 22, 32 };  ///< First bin of every band: 1.00, 2.15, 4.43, 10.1, 22.8 GV
+  ProtonAnalysis  *selection     = 0;                                ///< Proton selection (the registered one, or a private one)
+  bool             ownsSelection = false;                            ///< selection is a private one, deleted with the monitor
+
+  // Change-point search
+  double shift        = 0.05;   ///< Relative rate change tested for
+  double threshold    = 10;     ///< Alert threshold (log-likelihood ratio)
+  double timeConstant = 21600;  ///< Baseline time constant [s livetime]
+  double warmup       = 3600;   ///< Livetime before detecting [s]
+  vector<RateChangeDetector> detectors;
+
+  // Time series, index utime - firstSecond (seconds before firstSecond extend the series to the front)
+  unsigned int           firstSecond = 0;
+  vector<float>          livetime;
+  vector<unsigned char>  flags;            ///< Bits 0-3 band above the cut-off, bit 7 second has Compact entries
+  vector<unsigned short> counts;           ///< [second * bandNumber + band]
+  size_t                 nextSecond  = 0;  ///< First second not yet fed to the detectors
+  long                   lateEntries = 0;  ///< Entries of seconds already fed (chain out of time order)
+
+  RateMonitor(int bins, const double *edges, double factor) : ZoneAnalysis("RateMonitor", bins, edges, factor) {
+    detectors.assign(bandNumber, RateChangeDetector(shift, threshold, timeConstant, warmup));
+  }
+
+  ~RateMonitor() {
+    if (ownsSelection) delete selection;
+  }
+
+  vector<TString> columns() {
+    return selection->columns();
+  }
+
+  vector<TString> cheapColumns() {
+    return selection->cheapColumns();
+  }
+
+  //! First second of the series (start of the zone or time window), 0 for the first RTI second
+  void setOrigin(unsigned int utime) {
+    if (livetime.empty()) firstSecond = utime;
+  }
+
+  //! Index of a second in the series, -1 if it has no RTI (extend: add it)
+  long slot(unsigned int utime, bool extend) {
+
+    if (firstSecond == 0) firstSecond = utime;
+    if (utime < firstSecond) {
+      if (!extend) return -1;
+      size_t added = firstSecond - utime;
+      livetime.insert(livetime.begin(), added, 0);
+      flags.insert(flags.begin(), added, 0);
+      counts.insert(counts.begin(), added * bandNumber, 0);
+      firstSecond = utime;
+      if (nextSecond > 0) nextSecond += added;  // Seconds already fed stay fed
+    }
+
+    size_t second = utime - firstSecond;
+    if (second >= livetime.size()) {
+      if (!extend) return -1;
+      livetime.resize(second + 1, 0);
+      flags.resize(second + 1, 0);
+      counts.resize((second + 1) * bandNumber, 0);
+    }
+    return second;
+
+  }
+
+  void processRTI(const RTIInfo *rti) {
+
+    long second = slot(rti->utime, true);
+    livetime[second] = rti->lf;
+    for (int b=0; b < bandNumber; b++) {
+      if (binCentres[bandBins[b]] > cutOffFactor * rti->cf[0][3][1]) flags[second] |= 1 << b;
+    }
+
+  }
+
+  //! Feed the finished seconds before second to the detectors
+  void advance(size_t second) {
+    for (; nextSecond < second; nextSecond++) {
+      if ((flags[nextSecond] & 0x80) == 0) continue;
+      for (int b=0; b < bandNumber; b++) {
+        if (flags[nextSecond] & (1 << b)) {
+          detectors[b].add(firstSecond + nextSecond, counts[nextSecond * bandNumber + b], livetime[nextSecond]);
+        }
+      }
+    }
+  }
+
+  bool processCheap(const ZoneEvent &event) {
+
+    long second = slot(event.header->utime, false);
+    if (second < 0) return false;
+    if ((size_t)second < nextSecond) {
+      lateEntries++;
+    } else {
+      advance(second);
+    }
+    flags[second] |= 0x80;
+
+    const NtpCompact *c = event.compact;
+    bool boolRigidity = (c->trk_rig[0] > binEdges[0]) && (c->trk_rig[0] <= binEdges[binNumber]);
+    return boolRigidity && ((c->trigpatt & 0x02) != 0);
+
+  }
+
+  void processEvent(const ZoneEvent &event) {
+
+    unsigned short word = selection->wordCurrent ? selection->word : selection->selectionWord(event);
+    if ((word & 0x7F) != 0x7F) return;
+
+    float rigidity = event.compact->trk_rig[0];
+    long second = slot(event.header->utime, false);
+    for (int b=0; b < bandNumber; b++) {
+      if (rigidity > binEdges[bandBins[b]] && rigidity <= binEdges[bandBins[b + 1]]) {
+        unsigned short &count = counts[second * bandNumber + b];
+        if (count < 0xFFFF) count++;
+      }
+    }
+
+  }
+
+  //! Feed the last seconds, close the open alerts and write RateSeries, RateAlerts and the configuration
+  void write(TFile *f) {
+
+    advance(livetime.size());
+    vector<RateAlert> alerts;
+    for (int b=0; b < bandNumber; b++) {
+      detectors[b].finish();
+      for (auto &alert : detectors[b].alerts) {
+        alerts.push_back(alert);
+        alerts.back().band = b;
+      }
+    }
+
+    TDirectory *directory = f->mkdir(name);
+    directory->cd();
+
+    unsigned int utime; float lf; unsigned char bands; unsigned short bandCounts[bandNumber];
+    TTree *series = new TTree("RateSeries", "Selected proton counts per second and rigidity band");
+    series->Branch("utime", &utime, "utime/i");
+    series->Branch("livetime", &lf, "livetime/F");
+    series->Branch("bands", &bands, "bands/b");
+    series->Branch("counts", bandCounts, Form("counts[%d]/s", bandNumber));
+    for (size_t second=0; second < livetime.size(); second++) {
+      if ((flags[second] & 0x80) == 0) continue;
+      utime = firstSecond + second;
+      lf    = livetime[second];
+      bands = flags[second] & 0x0F;
+      for (int b=0; b < bandNumber; b++) bandCounts[b] = counts[second * bandNumber + b];
+      series->Fill();
+    }
+    series->Write();
+
+    RateAlert alert;
+    TTree *alertTree = new TTree("RateAlerts", "Intervals with a significant rate rise (kind +1) or drop (kind -1)");
+    alertTree->Branch("band", &alert.band, "band/I");
+    alertTree->Branch("kind", &alert.kind, "kind/I");
+    alertTree->Branch("start", &alert.start, "start/i");
+    alertTree->Branch("end", &alert.end, "end/i");
+    alertTree->Branch("peak", &alert.peak, "peak/i");
+    alertTree->Branch("statistic", &alert.statistic, "statistic/D");
+    alertTree->Branch("baseline", &alert.baseline, "baseline/D");
+    alertTree->Branch("observed", &alert.observed, "observed/D");
+    alertTree->Branch("livetime", &alert.livetime, "livetime/D");
+    for (auto &found : alerts) {
+      alert = found;
+      alertTree->Fill();
+    }
+    alertTree->Write();
+
+    TString bandEdges = "";
+    for (int b=0; b <= bandNumber; b++) bandEdges += Form(b == 0 ? "%g" : ",%g", binEdges[bandBins[b]]);
+    TNamed configuration("configuration", Form("bands %s GV, shift %g, threshold %g, baseline %g s, warm-up %g s, %ld late entries",
+                                               bandEdges.Data(), shift, threshold, timeConstant, warmup, lateEntries));
+    configuration.Write();
+
+    cout << "Rate monitor: " << series->GetEntries() << " seconds, " << alerts.size() << " alerts";
+    if (lateEntries > 0) cout << ", " << lateEntries << " entries out of time order (counted, not tested)";
+    cout << endl;
+    delete series;
+    delete alertTree;
+    f->cd();
+
+  }
+
+};
+
+//! Build an analysis from its name: proton, helium, antiproton, protontof or ratemonitor (0 if unknown)
+ZoneAnalysis *makeAnalysis(TString analysisName, int bins, const double *edges, double factor) {
+  analysisName.ToLower();
+  if (analysisName == "proton")     return new ProtonAnalysis(bins, edges, factor);
+  if (analysisName == "helium")     return new ChargeAnalysis("Helium", +1, false, 1.70, 2.40, bins, edges, factor);
+  if (analysisName == "antiproton") return new ChargeAnalysis("Antiproton", -1, false, 0.80, 1.30, bins, edges, factor);
+  if (analysisName == "protontof")  return new ChargeAnalysis("ProtonTOF", +1, true, 0.80, 1.50, bins, edges, factor);
+  if (analysisName == "ratemonitor") return new RateMonitor(bins, edges, factor);
+  return 0;
+}
+
+#endif
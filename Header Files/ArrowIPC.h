@@ -0,0 +1,333 @@
+#ifndef __ArrowIPC_h__
+#define __ArrowIPC_h__
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/** \file ArrowIPC.h
+Minimal writer for the Apache Arrow IPC file format (Feather v2), without any Arrow or ROOT dependency.
+Writes a single record batch of non-nullable int32, int64 and float64 columns plus key/value schema metadata.
+The column buffers are 64-byte aligned, so readers can memory-map the file and use them in place.
+*/
+
+/** \class ArrowFlatBuilder
+Back-to-front flatbuffer builder, just enough for the Arrow Schema, Message and Footer tables.
+Offsets returned by the builder are measured from the end of the buffer, as in the flatbuffers library.
+*/
+class ArrowFlatBuilder {
+
+ public:
+
+  vector<uint8_t> buffer;          ///< Bytes written so far, stored back to front
+  size_t minimumAlign = 1;         ///< Largest alignment used, the finished buffer is padded to it
+  vector<pair<int, uint32_t>> fields; ///< (slot, end offset) of the fields of the open table
+  uint32_t tableStart = 0;         ///< Size at the start of the open table
+
+  //! Bytes written so far
+  uint32_t size() const { return (uint32_t)buffer.size(); }
+
+  //! Prepend raw bytes
+  void prepend(const void *data, size_t length) {
+    const uint8_t *bytes = (const uint8_t*)data;
+    buffer.insert(buffer.begin(), bytes, bytes + length);
+  }
+
+  //! Pad so that after writing `length` more bytes the size is a multiple of `align`
+  void preAlign(size_t length, size_t align) {
+    if (align > minimumAlign) minimumAlign = align;
+    size_t padding = (align - ((size() + length) % align)) % align;
+    vector<uint8_t> zeros(padding, 0);
+    prepend(zeros.data(), padding);
+  }
+
+  //! Prepend an aligned scalar
+  template <class T> uint32_t scalar(T value) {
+    preAlign(sizeof(T), sizeof(T));
+    prepend(&value, sizeof(T));
+    return size();
+  }
+
+  //! Prepend a reference to an already written object
+  uint32_t offset(uint32_t target) {
+    preAlign(4, 4);
+    uint32_t value = size() + 4 - target;
+    prepend(&value, 4);
+    return size();
+  }
+
+  //! Null-terminated string
+  uint32_t string(const std::string &text) {
+    preAlign(text.size() + 1, 4);
+    uint8_t zero = 0;
+    prepend(&zero, 1);
+    prepend(text.data(), text.size());
+    uint32_t length = (uint32_t)text.size();
+    prepend(&length, 4);
+    return size();
+  }
+
+  //! Vector of references to tables or strings
+  uint32_t offsetVector(const vector<uint32_t> &targets) {
+    preAlign(4 * targets.size(), 4);
+    for (size_t i=targets.size(); i > 0; i--) {
+      offset(targets[i - 1]);
+    }
+    uint32_t length = (uint32_t)targets.size();
+    prepend(&length, 4);
+    return size();
+  }
+
+  //! Vector of structs made of 8-byte words
+  uint32_t structVector(const vector<vector<int64_t>> &structs, size_t structSize) {
+    preAlign(4 + structs.size() * structSize, 4);
+    preAlign(structs.size() * structSize, 8);
+    for (size_t i=structs.size(); i > 0; i--) {
+      vector<uint8_t> bytes(structSize, 0);
+      memcpy(bytes.data(), structs[i - 1].data(), structs[i - 1].size() * 8);
+      prepend(bytes.data(), structSize);
+    }
+    uint32_t length = (uint32_t)structs.size();
+    prepend(&length, 4);
+    return size();
+  }
+
+  //! Open a table, fields are added with the add*() methods
+  void startTable() {
+    fields.clear();
+    tableStart = size();
+  }
+
+  template <class T> void addScalar(int slot, T value) { fields.push_back(make_pair(slot, scalar(value))); }
+  void addOffset(int slot, uint32_t target) { fields.push_back(make_pair(slot, offset(target))); }
+
+  //! Close the table and write its vtable in front of it
+  uint32_t endTable() {
+    int32_t placeholder = 0;
+    uint32_t table = scalar(placeholder);
+
+    int slots = 0;
+    for (auto &field : fields) {
+      if (field.first + 1 > slots) slots = field.first + 1;
+    }
+    vector<uint16_t> vtable(2 + slots, 0);
+    vtable[0] = (uint16_t)(2 * (2 + slots));
+    vtable[1] = (uint16_t)(table - tableStart);
+    for (auto &field : fields) {
+      vtable[2 + field.first] = (uint16_t)(table - field.second);
+    }
+
+    preAlign(2 * vtable.size(), 2);
+    for (size_t i=vtable.size(); i > 0; i--) {
+      prepend(&vtable[i - 1], 2);
+    }
+
+    // The table points back to its vtable
+    int32_t distance = (int32_t)(size() - table);
+    memcpy(&buffer[size() - table], &distance, 4);
+
+    return table;
+  }
+
+  //! Write the root offset and return the finished bytes
+  vector<uint8_t> finish(uint32_t root) {
+    preAlign(4, minimumAlign > 8 ? minimumAlign : 8);
+    offset(root);
+    return buffer;
+  }
+
+};
+
+/** \class ArrowWriter
+Columnar table written as one Arrow IPC record batch.
+*/
+class ArrowWriter {
+
+ public:
+
+  struct Column {
+    std::string name;
+    int type;                      ///< 0: int32, 1: int64, 2: float64
+    vector<uint8_t> data;          ///< Little-endian values
+    int64_t length;
+  };
+
+  vector<Column> columns;
+  vector<pair<std::string, std::string>> metadata;
+
+  void addMetadata(const std::string &key, const std::string &value) { metadata.push_back(make_pair(key, value)); }
+
+  void addColumn(const std::string &name, const vector<int32_t> &values) { addRaw(name, 0, values.data(), values.size(), 4); }
+  void addColumn(const std::string &name, const vector<int64_t> &values) { addRaw(name, 1, values.data(), values.size(), 8); }
+  void addColumn(const std::string &name, const vector<double> &values)  { addRaw(name, 2, values.data(), values.size(), 8); }
+
+  //! Write the table to `path`, returns false on I/O errors or mismatched column lengths
+  bool write(const std::string &path);
+
+ private:
+
+  void addRaw(const std::string &name, int type, const void *values, size_t length, size_t width) {
+    Column column;
+    column.name   = name;
+    column.type   = type;
+    column.length = (int64_t)length;
+    column.data.assign((const uint8_t*)values, (const uint8_t*)values + length * width);
+    columns.push_back(column);
+  }
+
+  uint32_t schema(ArrowFlatBuilder &b);
+  static void pad(vector<uint8_t> &bytes, size_t align) { bytes.resize((bytes.size() + align - 1) / align * align, 0); }
+
+};
+
+// Schema table (Schema.fbs), shared by the schema message and the footer
+uint32_t ArrowWriter::schema(ArrowFlatBuilder &b) {
+
+  vector<uint32_t> fieldTables;
+  for (auto &column : columns) {
+
+    // Type table: Int { bitWidth, is_signed } or FloatingPoint { precision }
+    b.startTable();
+    if (column.type == 2) {
+      b.addScalar<int16_t>(0, 2);                   // DOUBLE
+    } else {
+      b.addScalar<int32_t>(0, column.type == 0 ? 32 : 64);
+      b.addScalar<uint8_t>(1, 1);
+    }
+    uint32_t type = b.endTable();
+
+    uint32_t name     = b.string(column.name);
+    uint32_t children = b.offsetVector(vector<uint32_t>());
+
+    b.startTable();
+    b.addOffset(0, name);
+    b.addScalar<uint8_t>(1, 0);                     // nullable
+    b.addScalar<uint8_t>(2, column.type == 2 ? 3 : 2); // Type union: Int = 2, FloatingPoint = 3
+    b.addOffset(3, type);
+    b.addOffset(5, children);
+    fieldTables.push_back(b.endTable());
+
+  }
+  uint32_t fieldVector = b.offsetVector(fieldTables);
+
+  vector<uint32_t> keyValues;
+  for (auto &entry : metadata) {
+    uint32_t key   = b.string(entry.first);
+    uint32_t value = b.string(entry.second);
+    b.startTable();
+    b.addOffset(0, key);
+    b.addOffset(1, value);
+    keyValues.push_back(b.endTable());
+  }
+  uint32_t metadataVector = b.offsetVector(keyValues);
+
+  b.startTable();
+  b.addScalar<int16_t>(0, 0);                       // Little endian
+  b.addOffset(1, fieldVector);
+  b.addOffset(2, metadataVector);
+  return b.endTable();
+
+}
+
+bool ArrowWriter::write(const std::string &path) {
+
+  int64_t rows = columns.empty() ? 0 : columns[0].length;
+  for (auto &column : columns) {
+    if (column.length != rows) return false;
+  }
+
+  // Record batch body: per column an empty validity buffer and a 64-byte aligned value buffer
+  vector<uint8_t> body;
+  vector<vector<int64_t>> nodes;
+  vector<vector<int64_t>> buffers;
+  for (auto &column : columns) {
+    nodes.push_back({ column.length, 0 });
+    buffers.push_back({ (int64_t)body.size(), 0 });
+    buffers.push_back({ (int64_t)body.size(), (int64_t)column.data.size() });
+    body.insert(body.end(), column.data.begin(), column.data.end());
+    pad(body, 64);
+  }
+
+  // Schema message
+  ArrowFlatBuilder schemaBuilder;
+  uint32_t schemaTable = schema(schemaBuilder);
+  schemaBuilder.startTable();
+  schemaBuilder.addScalar<int16_t>(0, 4);           // MetadataVersion V5
+  schemaBuilder.addScalar<uint8_t>(1, 1);           // MessageHeader: Schema
+  schemaBuilder.addOffset(2, schemaTable);
+  schemaBuilder.addScalar<int64_t>(3, 0);
+  vector<uint8_t> schemaMessage = schemaBuilder.finish(schemaBuilder.endTable());
+
+  // Record batch message
+  ArrowFlatBuilder batchBuilder;
+  uint32_t nodeVector   = batchBuilder.structVector(nodes, 16);
+  uint32_t bufferVector = batchBuilder.structVector(buffers, 16);
+  batchBuilder.startTable();
+  batchBuilder.addScalar<int64_t>(0, rows);
+  batchBuilder.addOffset(1, nodeVector);
+  batchBuilder.addOffset(2, bufferVector);
+  uint32_t batchTable = batchBuilder.endTable();
+  batchBuilder.startTable();
+  batchBuilder.addScalar<int16_t>(0, 4);
+  batchBuilder.addScalar<uint8_t>(1, 3);            // MessageHeader: RecordBatch
+  batchBuilder.addOffset(2, batchTable);
+  batchBuilder.addScalar<int64_t>(3, (int64_t)body.size());
+  vector<uint8_t> batchMessage = batchBuilder.finish(batchBuilder.endTable());
+
+  // File layout
+  vector<uint8_t> file;
+  const char magic[8] = { 'A', 'R', 'R', 'O', 'W', '1', 0, 0 };
+  file.insert(file.end(), magic, magic + 8);
+
+  // Encapsulated message: continuation marker, padded metadata length, metadata, body
+  auto message = [&](vector<uint8_t> metadataBytes, const vector<uint8_t> &bodyBytes) {
+    size_t start = file.size();
+    metadataBytes.resize(metadataBytes.size() + (64 - (start + 8 + metadataBytes.size()) % 64) % 64, 0);
+    int32_t marker = -1;
+    int32_t length = (int32_t)metadataBytes.size();
+    file.insert(file.end(), (uint8_t*)&marker, (uint8_t*)&marker + 4);
+    file.insert(file.end(), (uint8_t*)&length, (uint8_t*)&length + 4);
+    file.insert(file.end(), metadataBytes.begin(), metadataBytes.end());
+    int32_t metadataLength = (int32_t)(file.size() - start);
+    file.insert(file.end(), bodyBytes.begin(), bodyBytes.end());
+    return make_pair((int64_t)start, metadataLength);
+  };
+
+  message(schemaMessage, vector<uint8_t>());
+  pair<int64_t, int32_t> block = message(batchMessage, body);
+
+  // End-of-stream marker
+  int32_t eos[2] = { -1, 0 };
+  file.insert(file.end(), (uint8_t*)eos, (uint8_t*)eos + 8);
+
+  // Footer with the schema and the location of the record batch
+  ArrowFlatBuilder footerBuilder;
+  uint32_t footerSchema = schema(footerBuilder);
+  uint32_t dictionaries = footerBuilder.structVector(vector<vector<int64_t>>(), 24);
+  int64_t blockWords[3] = { block.first, block.second, (int64_t)body.size() };
+  uint32_t batches = footerBuilder.structVector({ vector<int64_t>(blockWords, blockWords + 3) }, 24);
+  footerBuilder.startTable();
+  footerBuilder.addScalar<int16_t>(0, 4);
+  footerBuilder.addOffset(1, footerSchema);
+  footerBuilder.addOffset(2, dictionaries);
+  footerBuilder.addOffset(3, batches);
+  vector<uint8_t> footer = footerBuilder.finish(footerBuilder.endTable());
+
+  file.insert(file.end(), footer.begin(), footer.end());
+  int32_t footerLength = (int32_t)footer.size();
+  file.insert(file.end(), (uint8_t*)&footerLength, (uint8_t*)&footerLength + 4);
+  file.insert(file.end(), magic, magic + 6);
+
+  ofstream output(path.c_str(), ios::binary | ios::trunc);
+  if (!output) return false;
+  output.write((const char*)file.data(), file.size());
+  return output.good();
+
+}
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef __ChangePoint_h__
+#define __ChangePoint_h__
+
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+/** \file ChangePoint.h
+Streaming change-point detection on a counting rate, one second at a time with O(1) state.
+The expected count of a second is baseline rate * livetime, the baseline an exponentially weighted mean of
+the past counts per livetime (time constant in seconds of livetime). Two Poisson CUSUMs test for a relative
+rise or fall of the rate by shift against it:
+  S+ = max(0, S+ + n ln(1 + shift) - mu shift)    S- = max(0, S- + n ln(1 - shift) + mu shift)
+A statistic above threshold raises an alert. The changed interval runs from the last time the statistic was
+zero to its maximum, the alert ends when the statistic is back at zero. The baseline skips the seconds of an
+open alert for up to one time constant, so a short event does not bias it (and its end is not seen as a change
+of the other sign); after that a lasting change is absorbed and ends its alert. Changes slower than the time
+constant are not flagged.
+*/
+
+/** \class RateAlert
+One interval with a significant rise (kind +1) or fall (kind -1) of the rate.
+*/
+class RateAlert {
+
+ public:
+
+  int          band = 0;   ///< Channel the rate belongs to (set by the caller)
+  int          kind;       ///< +1 spike, -1 drop
+  unsigned int start;      ///< First second of the interval [utime]
+  unsigned int peak;       ///< Last second of the interval, largest statistic [utime]
+  unsigned int end;        ///< Second the statistic was back at zero [utime]
+  double       statistic;  ///< Largest CUSUM statistic (log-likelihood ratio)
+  double       baseline;   ///< Baseline rate at the start [1/s livetime]
+  double       observed;   ///< Counts per livetime over start-peak [1/s]
+  double       livetime;   ///< Livetime of start-peak [s]
+
+};
+
+/** \class RateChangeDetector
+Two-sided Poisson CUSUM against an EWMA baseline.
+*/
+class RateChangeDetector {
+
+ public:
+
+  double shift;           ///< Relative rate change tested for
+  double threshold;       ///< Alert threshold on the CUSUM statistic
+  double timeConstant;    ///< Baseline time constant [s livetime]
+  double warmup;          ///< Livetime before detecting [s]
+
+  // Baseline
+  double weightedCounts   = 0;
+  double weightedLivetime = 0;
+  double seenLivetime     = 0;
+
+  // CUSUM per side, [0] spike, [1] drop
+  double       statistic[2]  = { 0, 0 };
+  bool         alerting[2]   = { false, false };
+  RateAlert    current[2];
+  double       counts[2]     = { 0, 0 };  ///< Counts since the statistic left zero
+  double       livetimes[2]  = { 0, 0 };  ///< Livetime since the statistic left zero
+  double       peakCounts[2] = { 0, 0 };  ///< Counts up to the maximum
+
+  vector<RateAlert> alerts;
+  unsigned int      lastSecond = 0;  ///< Last second added [utime]
+
+  RateChangeDetector(double relativeShift, double alertThreshold, double baselineTime, double warmupTime) {
+    shift        = relativeShift;
+    threshold    = alertThreshold;
+    timeConstant = baselineTime;
+    warmup       = warmupTime;
+  }
+
+  //! Baseline rate [1/s livetime], 0 before any livetime
+  double baseline() const {
+    return weightedLivetime > 0 ? weightedCounts / weightedLivetime : 0;
+  }
+
+  //! Add the counts of one second with livetime lf
+  void add(unsigned int utime, double n, double lf) {
+
+    if (lf <= 0) return;
+    lastSecond = utime;
+
+    double rate = baseline();
+    if (seenLivetime >= warmup && rate > 0) {
+      double mu = rate * lf;
+      double steps[2] = { n * log(1 + shift) - mu * shift, n * log(1 - shift) + mu * shift };
+      for (int side=0; side < 2; side++) {
+
+        // The interval starts where the statistic leaves zero
+        if (statistic[side] == 0) {
+          current[side].start     = utime;
+          current[side].baseline  = rate;
+          current[side].statistic = 0;
+          current[side].livetime  = 0;
+          counts[side]            = 0;
+          livetimes[side]         = 0;
+          peakCounts[side]        = 0;
+        }
+        statistic[side] = max(0., statistic[side] + steps[side]);
+        counts[side]    += n;
+        livetimes[side] += lf;
+        if (statistic[side] > current[side].statistic) {
+          current[side].statistic = statistic[side];
+          current[side].peak      = utime;
+          current[side].livetime  = livetimes[side];
+          peakCounts[side]        = counts[side];
+        }
+        alerting[side] = alerting[side] || statistic[side] > threshold;
+
+        if (statistic[side] == 0) {
+          if (alerting[side]) close(side, utime);
+          alerting[side] = false;
+        }
+
+      }
+    }
+
+    // Baseline after the test, so a second is never compared with itself
+    for (int side=0; side < 2; side++) {
+      if (alerting[side] && livetimes[side] < timeConstant) return;
+    }
+    double decay = exp(-lf / timeConstant);
+    weightedCounts   = weightedCounts * decay + n;
+    weightedLivetime = weightedLivetime * decay + lf;
+    seenLivetime    += lf;
+
+  }
+
+  //! Close the alerts still open at the end of the series
+  void finish() {
+    for (int side=0; side < 2; side++) {
+      if (alerting[side]) close(side, lastSecond);
+      alerting[side]  = false;
+      statistic[side] = 0;
+    }
+  }
+
+  void close(int side, unsigned int utime) {
+    RateAlert alert = current[side];
+    alert.kind     = side == 0 ? +1 : -1;
+    alert.end      = utime;
+    alert.observed = alert.livetime > 0 ? peakCounts[side] / alert.livetime : 0;
+    alerts.push_back(alert);
+  }
+
+};
+
+#endif
@@ -0,0 +1,260 @@
+#ifndef __FluxStore_h__
+#define __FluxStore_h__
+
+#include "TFile.h"
+#include "TH1F.h"
+#include "TObjArray.h"
+#include "TObjString.h"
+#include "TString.h"
+#include "TSystem.h"
+
+#include <cmath>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "ZoneFlux.h"
+
+using namespace std;
+
+/** \file FluxStore.h
+All zone accumulators and the MC histograms in memory, answering flux, rate and efficiency queries.
+The ten flux histograms of every zone (see zoneFluxHistograms) are kept as running sums over the zones, so
+the counts of any zone range are one subtraction per bin; merged bins sum their counts and take the width
+weighted mean of the exposure. The flux itself is fluxTerms() of ZoneFlux.h, the same as GraphLooper.
+
+Queries are one line of text, answers are lines of text closed by a line "end":
+  flux <t0> <t1> [rebin=<n> | edges=<R0>,<R1>,...] [corrections=<mask>]   low high flux error
+  rate <t0> <t1> [rebin/edges]                                             low high rate error
+  efficiency <t0> <t1> [rebin/edges]                                       low high trigger mcTrigger selection mcSelection
+  zones                                                                    zone start end loaded
+The time range [t0, t1) (utime) covers every zone it overlaps, the answer starts with a "#" line naming the
+zones and the time range actually used. Rebinned edges must be edges of the 32-bin scheme; corrections is a mask
+of ZoneFluxCorrection bits (default 0x1F, all corrections as in GraphLooper) choosing which data/MC efficiency
+corrections are applied. It does not change the event selection: the stored counts always passed every cut.
+Errors are answered as "error ...".
+*/
+
+/** \class FluxStore
+In-memory zone accumulators with a text query interface.
+*/
+class FluxStore {
+
+ public:
+
+  int              zoneNumber;    ///< Number of zones
+  int              binNumber;     ///< Number of rigidity bins
+  vector<double>   binEdges;      ///< Rigidity bin edges [GV]
+  vector<long>     zoneEdges;     ///< Zone boundaries [utime], zoneNumber + 1
+  vector<bool>     zoneLoaded;    ///< Zone file found and complete
+  vector<double>   runningSums;   ///< Sum over zones < z of histogram k, bin i: [(z * 10 + k) * binNumber + i]
+  vector<double>   mcContents;    ///< MC histogram k, bin i: [k * binNumber + i]
+  TString          zonePattern;   ///< Zone files, %d for the zone index
+  TString          mcPath;        ///< HistMaker output
+
+  FluxStore(int zones, const int *zoneBoundaries, int bins, const double *edges) {
+    zoneNumber = zones;
+    binNumber  = bins;
+    binEdges.assign(edges, edges + bins + 1);
+    zoneEdges.assign(zoneBoundaries, zoneBoundaries + zones + 1);
+  }
+
+  //! Read every zone file and the MC file into memory, returns the number of loaded zones
+  int load(TString zoneFiles, TString mcFile) {
+
+    zonePattern = zoneFiles;
+    mcPath      = mcFile;
+    zoneLoaded.assign(zoneNumber, false);
+    runningSums.assign((zoneNumber + 1) * 10 * binNumber, 0);
+    mcContents.assign(10 * binNumber, 0);
+
+    TFile *mc = gSystem->AccessPathName(mcPath) ? 0 : TFile::Open(mcPath);
+    for (int k=0; k < 10; k++) {
+      TH1F *histogram = mc ? (TH1F*)mc->Get(zoneFluxMonteCarlo[k]) : 0;
+      if (!histogram) {
+        cout << "Missing " << zoneFluxMonteCarlo[k] << " in " << mcPath << endl;
+        delete mc;
+        return 0;
+      }
+      for (int i=0; i < binNumber; i++) mcContents[k * binNumber + i] = histogram->GetBinContent(i + 1);
+    }
+    delete mc;
+
+    int loaded = 0;
+    for (int z=0; z < zoneNumber; z++) {
+
+      // Carry the sums, a missing zone adds nothing
+      for (int j=0; j < 10 * binNumber; j++) {
+        runningSums[(z + 1) * 10 * binNumber + j] = runningSums[z * 10 * binNumber + j];
+      }
+
+      TString path = Form(zonePattern.Data(), z);
+      TFile *zone = gSystem->AccessPathName(path) ? 0 : TFile::Open(path);
+      if (!zone) continue;
+
+      TH1F *histograms[10];
+      bool complete = true;
+      for (int k=0; k < 10; k++) {
+        histograms[k] = (TH1F*)zone->Get(zoneFluxHistograms[k]);
+        complete = complete && histograms[k];
+      }
+      if (complete) {
+        for (int k=0; k < 10; k++) {
+          for (int i=0; i < binNumber; i++) {
+            runningSums[((z + 1) * 10 + k) * binNumber + i] += histograms[k]->GetBinContent(i + 1);
+          }
+        }
+        zoneLoaded[z] = true;
+        loaded++;
+      }
+      delete zone;
+
+    }
+
+    return loaded;
+
+  }
+
+  //! Content of histogram k (see zoneFluxHistograms), bin i, summed over the zones zoneFirst-zoneLast
+  double zoneSum(int zoneFirst, int zoneLast, int k, int i) const {
+    return runningSums[((zoneLast + 1) * 10 + k) * binNumber + i] - runningSums[(zoneFirst * 10 + k) * binNumber + i];
+  }
+
+  //! Answer one query line (see the file documentation)
+  TString query(TString line) {
+
+    TObjArray *tokens = line.Tokenize(" \t");
+    vector<TString> words;
+    for (int i=0; i < tokens->GetEntriesFast(); i++) words.push_back(((TObjString*)tokens->At(i))->GetString());
+    delete tokens;
+
+    if (words.empty()) return "error empty query\nend\n";
+    TString command = words[0];
+    command.ToLower();
+
+    if (command == "zones") {
+      TString answer = "";
+      for (int z=0; z < zoneNumber; z++) {
+        answer += Form("%d %ld %ld %d\n", z, zoneEdges[z], zoneEdges[z + 1], (int)zoneLoaded[z]);
+      }
+      return answer + "end\n";
+    }
+    if (command != "flux" && command != "rate" && command != "efficiency") {
+      return Form("error unknown query %s (flux, rate, efficiency, zones)\nend\n", command.Data());
+    }
+    if (words.size() < 3 || !words[1].IsDigit() || !words[2].IsDigit()) {
+      return Form("error usage: %s <t0> <t1> [rebin=<n> | edges=<R0>,<R1>,...] [corrections=<mask>]\nend\n", command.Data());
+    }
+
+    // Options
+    long t0 = words[1].Atoll(); long t1 = words[2].Atoll();
+    vector<pair<int, int>> groups;
+    int corrections = kFluxAll;
+    TString error = "";
+    for (size_t w=3; w < words.size(); w++) {
+      if (words[w].BeginsWith("rebin=")) {
+        error = rebinGroups(TString(words[w](6, words[w].Length())).Atoi(), groups);
+      } else if (words[w].BeginsWith("edges=")) {
+        error = edgeGroups(words[w](6, words[w].Length()), groups);
+      } else if (words[w].BeginsWith("corrections=")) {
+        corrections = (int)strtol(TString(words[w](12, words[w].Length())).Data(), 0, 0) & kFluxAll;
+      } else {
+        error = Form("unknown option %s", words[w].Data());
+      }
+      if (error.Length() > 0) return "error " + error + "\nend\n";
+    }
+    if (groups.empty()) rebinGroups(1, groups);
+
+    // Zones overlapping [t0, t1)
+    int zoneFirst = -1; int zoneLast = -1; int loaded = 0;
+    for (int z=0; z < zoneNumber; z++) {
+      if (zoneEdges[z] < t1 && zoneEdges[z + 1] > t0) {
+        if (zoneFirst < 0) zoneFirst = z;
+        zoneLast = z;
+        loaded += zoneLoaded[z];
+      }
+    }
+    if (loaded == 0) return Form("error no loaded zone overlaps %ld-%ld\nend\n", t0, t1);
+
+    // Summed and merged contents
+    int groupNumber = groups.size();
+    vector<vector<double>> hMerged(10, vector<double>(groupNumber, 0)), mMerged(10, vector<double>(groupNumber, 0));
+    vector<double> groupEdges;
+    for (int g=0; g < groupNumber; g++) {
+      double width = binEdges[groups[g].second + 1] - binEdges[groups[g].first];
+      for (int i=groups[g].first; i <= groups[g].second; i++) {
+        double binWidth = binEdges[i + 1] - binEdges[i];
+        for (int k=0; k < 10; k++) {
+          double sum = zoneSum(zoneFirst, zoneLast, k, i);
+          // Exposure is livetime per bin, not a count
+          hMerged[k][g] += k == 0 ? sum * binWidth / width : sum;
+          mMerged[k][g] += mcContents[k * binNumber + i];
+        }
+      }
+      groupEdges.push_back(binEdges[groups[g].first]);
+    }
+    groupEdges.push_back(binEdges[groups.back().second + 1]);
+
+    const double *h[10]; const double *m[10];
+    for (int k=0; k < 10; k++) {
+      h[k] = hMerged[k].data();
+      m[k] = mMerged[k].data();
+    }
+
+    TString answer = Form("# %s zones %d-%d (%d loaded) utime %ld-%ld corrections 0x%02X\n", command.Data(), zoneFirst, zoneLast,
+                          loaded, zoneEdges[zoneFirst], zoneEdges[zoneLast + 1], corrections);
+    for (int g=0; g < groupNumber; g++) {
+      double width = groupEdges[g + 1] - groupEdges[g];
+      FluxTerms terms = fluxTerms(h, m, g, width, corrections);
+      answer += Form("%g %g ", groupEdges[g], groupEdges[g + 1]);
+      if (command == "flux") {
+        answer += Form("%g %g\n", terms.flux, terms.fluxError);
+      } else if (command == "rate") {
+        double exposure = h[0][g];
+        answer += Form("%g %g\n", terms.rate, exposure > 0 ? sqrt(h[1][g]) / exposure / width : 0.);
+      } else {
+        answer += Form("%g %g %g %g\n", terms.trigger, terms.mcTrigger, terms.selection, terms.mcSelection);
+      }
+    }
+
+    return answer + "end\n";
+
+  }
+
+  //! Groups of n adjacent bins (the last group takes the remainder)
+  TString rebinGroups(int n, vector<pair<int, int>> &groups) {
+    if (n < 1 || n > binNumber) return Form("rebin must be 1-%d", binNumber);
+    groups.clear();
+    for (int i=0; i < binNumber; i += n) groups.push_back({ i, min(i + n, binNumber) - 1 });
+    return "";
+  }
+
+  //! Groups between the requested edges, which must be edges of the binning
+  TString edgeGroups(TString list, vector<pair<int, int>> &groups) {
+
+    TObjArray *values = list.Tokenize(",");
+    vector<int> indices;
+    for (int j=0; j < values->GetEntriesFast(); j++) {
+      double edge = ((TObjString*)values->At(j))->GetString().Atof();
+      int index = -1;
+      for (int i=0; i <= binNumber; i++) {
+        if (fabs(binEdges[i] - edge) < 1e-3 * binEdges[i]) index = i;
+      }
+      if (index < 0 || (!indices.empty() && index <= indices.back())) {
+        delete values;
+        return Form("edge %g is not an increasing bin edge", edge);
+      }
+      indices.push_back(index);
+    }
+    delete values;
+    if (indices.size() < 2) return "edges needs at least two edges";
+
+    groups.clear();
+    for (size_t j=0; j + 1 < indices.size(); j++) groups.push_back({ indices[j], indices[j + 1] - 1 });
+    return "";
+
+  }
+
+};
+
+#endif
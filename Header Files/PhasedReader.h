@@ -0,0 +1,156 @@
+#ifndef __PhasedReader_h__
+#define __PhasedReader_h__
+
+#include "TBranch.h"
+#include "TChain.h"
+#include "TObjArray.h"
+#include "TString.h"
+#include "TTree.h"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+/** \file PhasedReader.h
+Late materialization of the Compact columns.
+Phase 1 reads SHeader and the cheap columns the analyses need to reject an entry (ZoneAnalysis::cheapColumns()),
+phase 2 reads the remaining columns only if an analysis kept the entry. The analyses see the same values as
+with a full read, so the accumulators are identical; the decoding of the rejected entries is saved.
+Whether this pays off depends on the rejection rate and on how much of the cost is basket decompression (paid
+anyway once a basket holds a survivor), so the warm-up alternates blocks of one- and two-phase reads and the
+faster mode is kept for the rest of the loop. Unsplit Compact branches are always read in one go.
+*/
+
+/** \class PhasedReader
+Reads one Compact entry of a chain in one or two phases.
+*/
+class PhasedReader {
+
+ public:
+
+  TChain          *chain;
+  vector<TString>  cheapColumns;           ///< Phase 1 columns
+  vector<TString>  restColumns;            ///< Phase 2 columns
+  bool             split        = false;   ///< Compact members can be read on their own (current tree)
+  bool             twoPhase     = true;    ///< Current mode
+  bool             warmingUp    = true;    ///< Still measuring both modes
+  Long64_t         warmupBlock  = 1000;    ///< Entries per warm-up block
+  int              warmupBlocks = 20;      ///< Warm-up blocks, alternating one- and two-phase
+
+  // Measurement
+  Long64_t         calls        = 0;
+  Long64_t         survivors    = 0;
+  double           modeSeconds[2] = { 0, 0 };  ///< Warm-up time, [0] one-phase, [1] two-phase
+  chrono::steady_clock::time_point blockStart;
+
+  // Branches of the current tree
+  int              treeNumber   = -1;
+  Long64_t         localEntry   = 0;
+  vector<TBranch*> cheapBranches;
+  vector<TBranch*> restBranches;
+
+  PhasedReader(TChain *compactChain, vector<TString> cheap, vector<TString> rest) {
+    chain        = compactChain;
+    cheapColumns = cheap;
+    restColumns  = rest;
+  }
+
+  //! Phase 1: SHeader and the cheap columns (everything in one-phase mode)
+  void readCheap(Long64_t entry) {
+
+    if (warmingUp) measure();
+
+    localEntry = chain->LoadTree(entry);
+    if (chain->GetTreeNumber() != treeNumber) refresh();
+
+    if (!split) {
+      chain->GetEntry(entry);
+      return;
+    }
+    for (auto branch : cheapBranches) branch->GetEntry(localEntry);
+    if (!twoPhase) {
+      for (auto branch : restBranches) branch->GetEntry(localEntry);
+    }
+
+  }
+
+  //! Phase 2: the remaining columns, if an analysis kept the entry
+  void readRest(bool survivor) {
+    survivors += survivor;
+    if (!split || !twoPhase || !survivor) return;
+    for (auto branch : restBranches) branch->GetEntry(localEntry);
+  }
+
+  //! Sort the Compact members of a new tree into the two phases
+  void refresh() {
+
+    treeNumber = chain->GetTreeNumber();
+    cheapBranches.clear();
+    restBranches.clear();
+
+    TTree *tree = chain->GetTree();
+    TBranch *branchCompact = tree->GetBranch("Compact");
+    split = branchCompact && branchCompact->GetListOfBranches()->GetEntries() > 0;
+    if (!split) return;
+
+    if (TBranch *branchSHeader = tree->GetBranch("SHeader")) {
+      cheapBranches.push_back(branchSHeader);
+    }
+    TObjArray *members = branchCompact->GetListOfBranches();
+    for (int i=0; i < members->GetEntriesFast(); i++) {
+      TBranch *branch = (TBranch*)members->At(i);
+      // Array members are stored as e.g. "trk_rig[5]"
+      if (matches(branch->GetName(), cheapColumns)) {
+        cheapBranches.push_back(branch);
+      } else if (matches(branch->GetName(), restColumns)) {
+        restBranches.push_back(branch);
+      }
+    }
+
+    // Every active member is cached, phase 2 ones included: their baskets are still fetched for every cluster,
+    // only the decoding of the rejected entries is saved
+    tree->AddBranchToCache("*", kTRUE);
+    tree->StopCacheLearningPhase();
+
+  }
+
+  //! Branch of one of the columns: the column itself, an array member ("trk_rig[5]") or a sub-member ("column.x")
+  static bool matches(TString branchName, const vector<TString> &columns) {
+    for (auto &column : columns) {
+      if (branchName == column || branchName.BeginsWith(column + "[") || branchName.BeginsWith(column + ".")) return true;
+    }
+    return false;
+  }
+
+  //! Time the warm-up blocks, switch mode between blocks and keep the faster one
+  void measure() {
+
+    Long64_t call = calls++;
+    if (call % warmupBlock != 0) return;
+
+    auto now = chrono::steady_clock::now();
+    int block = (int)(call / warmupBlock);
+    if (block > 0) {
+      modeSeconds[twoPhase] += chrono::duration<double>(now - blockStart).count();
+    }
+    blockStart = now;
+
+    if (block < warmupBlocks) {
+      twoPhase = block % 2 == 1;
+      return;
+    }
+
+    warmingUp = false;
+    twoPhase  = modeSeconds[1] < modeSeconds[0];
+    double entries = warmupBlock * warmupBlocks / 2.;
+    cout << "Late materialization: " << 100. * survivors / call << "% of the entries pass phase 1, "
+         << 1e6 * modeSeconds[0] / entries << " us/entry one-phase, " << 1e6 * modeSeconds[1] / entries
+         << " us/entry two-phase, reading " << (twoPhase ? "two" : "one") << "-phase" << endl;
+
+  }
+
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef __Sampling_h__
+#define __Sampling_h__
+
+#include "TH1.h"
+#include "TString.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+/** \file Sampling.h
+Quick-look sampling of run files.
+The files (in time order) are cut into strata of round(1/fraction) consecutive files and one file per
+stratum is kept, so the sample covers the whole time range and is the same on every call.
+The loops scale the sampled counts back up with scaleCounts() and mark their output as sampled.
+*/
+
+//! Flags the sampled files, files are ordered by name (run files are named after their start time)
+vector<bool> sampleFiles(const vector<TString> &files, double fraction, unsigned int seed = 0) {
+
+  vector<bool> sampled(files.size(), fraction >= 1);
+  if (fraction >= 1 || files.empty()) return sampled;
+
+  vector<size_t> order(files.size());
+  for (size_t i=0; i < order.size(); i++) order[i] = i;
+  sort(order.begin(), order.end(), [&files](size_t a, size_t b) { return files[a] < files[b]; });
+
+  size_t stratum = max((size_t)1, (size_t)round(1 / max(fraction, 1e-6)));
+  for (size_t first=0; first < order.size(); first += stratum) {
+    size_t size = min(stratum, order.size() - first);
+    // Position inside the stratum varies, so the sample does not lock onto a periodic pattern
+    size_t pick = (size_t)(((first / stratum) * 2654435761u + seed) % size);
+    sampled[order[first + pick]] = true;
+  }
+
+  return sampled;
+
+}
+
+//! Scale bin j + 1 by weights[j] (under- and overflow take the nearest bin), with scaled Poisson errors
+void scaleCounts(TH1 *histogram, const double *weights) {
+
+  int bins = histogram->GetNbinsX();
+  for (int i=0; i <= bins + 1; i++) {
+    double weight = weights[min(max(i, 1), bins) - 1];
+    double error  = histogram->GetBinError(i);
+    histogram->SetBinContent(i, histogram->GetBinContent(i) * weight);
+    histogram->SetBinError(i, error * weight);
+  }
+
+}
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef __SelectionSidecar_h__
+#define __SelectionSidecar_h__
+
+#include "TFile.h"
+#include "TNamed.h"
+#include "TString.h"
+#include "TSystem.h"
+#include "TTree.h"
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/** \file SelectionSidecar.h
+Per-file sidecar with the proton selection bits of every Compact entry (see ProtonAnalysis::selectionWord()):
+  bits 0-6  boolBit (cut-off, rigidity, triggers, particle, beta, chi squared, inner layer)
+  bit  7    TOF charge
+  bit  8    bias trigger
+The sidecar of <run>.root is <sidecar directory>/<run>.selection.root and holds
+  Selection      one row per Compact entry (bits/s), row i belongs to Compact entry i (about a byte per entry compressed)
+  SelectionRuns  the same words run-length encoded (bits, first, last)
+  source         size and mtime of the run file
+  cuts           selectionCuts(): every cut value the bits were computed with
+A sidecar of another version of the run file or of other cuts is ignored. Later jobs read only the entries
+matching a mask (entryRanges()) or replay the proton histograms from the bits and trk_rig (SelectionReplay.C).
+*/
+
+/** \class SelectionSidecar
+Writes and reads the selection sidecars of run files.
+*/
+class SelectionSidecar {
+
+ public:
+
+  TString                directory;      ///< Directory with the sidecar files
+  TString                cuts;           ///< Cut configuration the bits belong to
+  TString                currentSource;  ///< Run file being written, empty if none
+  vector<unsigned short> words;          ///< Words of the run file being written
+  int                    written = 0;    ///< Sidecars written by this job
+
+  SelectionSidecar(TString sidecarDirectory, TString selectionCuts) {
+    directory = sidecarDirectory;
+    cuts      = selectionCuts;
+    gSystem->mkdir(directory, kTRUE);
+  }
+
+  //! Cut configuration of ProtonAnalysis::selectionWord(), stored with and compared against every sidecar
+  /** Lists the constants of selectionWord() as well as its parameters; any change of a cut there must be
+      made here too, so sidecars computed with the old cuts are ignored.
+   */
+  static TString selectionCuts(double cutOffFactor, double rigidityMin, double rigidityMax) {
+    return Form("cut-off factor %g, rigidity %g-%g GV, sublvl1 0x3E, trigpatt 0x02, status %% 10 == 1, beta > 0.3, "
+                "chi squared 0-10, inner charge 0.80-1.30, TOF charge 0.8-1.5", cutOffFactor, rigidityMin, rigidityMax);
+  }
+
+  //! Sidecar file of a run file
+  TString sidecarPath(TString runFile) {
+    TString name = gSystem->BaseName(runFile);
+    name.ReplaceAll(".root", "");
+    return Form("%s/%s.selection.root", directory.Data(), name.Data());
+  }
+
+  //! Size and mtime of the run file, as stored in the sidecar
+  TString sourceStamp(TString runFile) {
+    FileStat_t info;
+    if (gSystem->GetPathInfo(runFile, info) != 0) return "";
+    return Form("%lld %ld", info.fSize, info.fMtime);
+  }
+
+  //! Start the sidecar of a run file with entries Compact entries (writes the previous one)
+  void open(TString runFile, Long64_t entries) {
+    close();
+    currentSource = runFile;
+    words.assign(entries, 0);
+  }
+
+  void set(Long64_t entry, unsigned short word) {
+    words[entry] = word;
+  }
+
+  //! Write the sidecar of the current run file through a temporary file of this process
+  bool close() {
+
+    if (currentSource.Length() == 0) return false;
+    TString path = sidecarPath(currentSource);
+
+    TString part = Form("%s.%d.part", path.Data(), gSystem->GetPid());
+    TFile *output = TFile::Open(part, "recreate");
+    if (!output || output->IsZombie()) {
+      cout << "Could not write " << path << endl;
+      currentSource = "";
+      return false;
+    }
+
+    unsigned short bits; Long64_t first; Long64_t last;
+    TTree *selection = new TTree("Selection", "Proton selection bits per Compact entry");
+    selection->Branch("bits", &bits, "bits/s");
+    for (auto word : words) {
+      bits = word;
+      selection->Fill();
+    }
+
+    TTree *runs = new TTree("SelectionRuns", "Run-length encoded proton selection bits");
+    runs->Branch("bits", &bits, "bits/s");
+    runs->Branch("first", &first, "first/L");
+    runs->Branch("last", &last, "last/L");
+    for (Long64_t i=0; i < (Long64_t)words.size(); i++) {
+      if (i > 0 && words[i] == bits) {
+        last = i;
+        continue;
+      }
+      if (i > 0) runs->Fill();
+      bits  = words[i];
+      first = i;
+      last  = i;
+    }
+    if (!words.empty()) runs->Fill();
+
+    TNamed source("source", sourceStamp(currentSource));
+    TNamed configuration("cuts", cuts);
+    output->cd();
+    selection->Write();
+    runs->Write();
+    source.Write();
+    configuration.Write();
+    delete output;
+
+    currentSource = "";
+    words.clear();
+    bool renamed = gSystem->Rename(part, path) == 0;
+    if (!renamed) gSystem->Unlink(part);
+    written += renamed;
+    return renamed;
+
+  }
+
+  //! Open the sidecar of a run file, 0 if it is missing, stale or of other cuts
+  TFile *openSidecar(TString runFile) {
+
+    TString path = sidecarPath(runFile);
+    TFile *file = gSystem->AccessPathName(path) ? 0 : TFile::Open(path);
+    TNamed *source        = file ? (TNamed*)file->Get("source") : 0;
+    TNamed *configuration = file ? (TNamed*)file->Get("cuts") : 0;
+    TString stamp = sourceStamp(runFile);
+
+    if (!source || !configuration || cuts != configuration->GetTitle() ||
+        (stamp.Length() > 0 && stamp != source->GetTitle())) {
+      delete file;
+      return 0;
+    }
+    return file;
+
+  }
+
+  //! Words of every Compact entry of runFile (valid is false without a sidecar)
+  vector<unsigned short> load(TString runFile, bool &valid) {
+
+    vector<unsigned short> entryWords;
+    TFile *file = openSidecar(runFile);
+    valid = file != 0;
+    if (!file) return entryWords;
+
+    TTree *selection = (TTree*)file->Get("Selection");
+    unsigned short bits;
+    selection->SetBranchAddress("bits", &bits);
+    entryWords.resize(selection->GetEntries());
+    for (Long64_t i=0; i < selection->GetEntries(); i++) {
+      selection->GetEntry(i);
+      entryWords[i] = bits;
+    }
+
+    delete file;
+    return entryWords;
+
+  }
+
+  //! Entry ranges [first, last] of runFile with (bits & mask) == mask, adjacent runs merged (valid is false without a sidecar)
+  vector<pair<Long64_t, Long64_t>> entryRanges(TString runFile, unsigned short mask, bool &valid) {
+
+    vector<pair<Long64_t, Long64_t>> ranges;
+    TFile *file = openSidecar(runFile);
+    valid = file != 0;
+    if (!file) return ranges;
+
+    TTree *runs = (TTree*)file->Get("SelectionRuns");
+    unsigned short bits; Long64_t first; Long64_t last;
+    runs->SetBranchAddress("bits", &bits);
+    runs->SetBranchAddress("first", &first);
+    runs->SetBranchAddress("last", &last);
+
+    for (Long64_t i=0; i < runs->GetEntries(); i++) {
+      runs->GetEntry(i);
+      if ((bits & mask) != mask) continue;
+      if (!ranges.empty() && ranges.back().second + 1 == first) {
+        ranges.back().second = last;
+      } else {
+        ranges.push_back({ first, last });
+      }
+    }
+
+    delete file;
+    return ranges;
+
+  }
+
+};
+
+#endif
@@ -0,0 +1,318 @@
+#ifndef __StageCache_h__
+#define __StageCache_h__
+
+#include "TMD5.h"
+#include "TRegexp.h"
+#include "TString.h"
+#include "TSystem.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+using namespace std;
+
+/** \file StageCache.h
+Node-local staging cache for the EOS run files.
+resolve() copies a source file into the cache directory (once per node) and returns the local copy,
+every job on the node that asks for the same file afterwards reads it from local disk.
+Staging is switched on through the environment, so the condor jobs keep their arguments:
+  AMS_STAGE_CACHE         cache directory on the node (unset: all paths are returned unchanged)
+  AMS_STAGE_CACHE_GB      size cap of the cache [GB] (default 50)
+  AMS_STAGE_CACHE_VERIFY  1: recompute the MD5 of a cached file on every hit
+Any local directory can stand in for EOS, the sources are plain (fuse mounted) paths.
+
+Cache layout, per source file:
+  <md5 of source path>_<file name>        the copy
+  <md5 of source path>_<file name>.meta   source size, source mtime and MD5 of the copy
+  <md5 of source path>_<file name>.lock   flock: shared while a job checks, copies or uses the copy
+  <md5 of source path>_<file name>.copy   flock: exclusive while a job copies
+A copy is only valid if its meta matches the current size and mtime of the source. Copies are written
+to a .part file, checked against the MD5 computed while reading the source and then renamed.
+Jobs only wait for each other while one of them copies the same file; no job waits for a lock while it
+holds the .copy lock of another file, so staging lists in any order cannot deadlock.
+Eviction (least recently used first, under .evict.lock) skips every copy that is locked by a job.
+*/
+
+/** \class StageCache
+Resolves source paths to verified copies in the node-local cache.
+*/
+class StageCache {
+
+ public:
+
+  TString     directory;         ///< Cache directory, empty if staging is disabled
+  Long64_t    sizeLimit;         ///< Size cap of the cache [bytes]
+  bool        verifyHits;        ///< Recompute the MD5 of cached copies on every hit
+  int         hits     = 0;      ///< Resolved from the cache
+  int         copies   = 0;      ///< Copied into the cache
+  int         failures = 0;      ///< Fell back to the source path
+  vector<int> heldLocks;         ///< Shared locks on the copies in use by this job
+
+  StageCache(TString cacheDirectory = "", double limitGB = 0) {
+
+    const char *environment = getenv("AMS_STAGE_CACHE");
+    directory = cacheDirectory.Length() > 0 ? cacheDirectory : TString(environment ? environment : "");
+
+    const char *limit = getenv("AMS_STAGE_CACHE_GB");
+    if (limitGB <= 0) limitGB = limit ? atof(limit) : 50;
+    sizeLimit = (Long64_t)(limitGB * 1e9);
+
+    const char *verify = getenv("AMS_STAGE_CACHE_VERIFY");
+    verifyHits = verify && atoi(verify) != 0;
+
+    if (directory.Length() > 0) {
+      gSystem->mkdir(directory, kTRUE);
+      if (gSystem->AccessPathName(directory, kWritePermission)) {
+        cout << "Stage cache " << directory << " is not writable, reading sources directly" << endl;
+        directory = "";
+      }
+    }
+
+  }
+
+  ~StageCache() {
+    for (auto lock : heldLocks) close(lock);
+  }
+
+  bool enabled() const { return directory.Length() > 0; }
+
+  //! Expand a wildcard in the file name (e.g. ".../604*.root"), sorted
+  vector<TString> expand(TString pattern) {
+
+    vector<TString> paths;
+    if (!pattern.MaybeWildcard()) {
+      paths.push_back(pattern);
+      return paths;
+    }
+
+    TString parent = gSystem->DirName(pattern);
+    TRegexp wildcard(gSystem->BaseName(pattern), kTRUE);
+
+    void *dir = gSystem->OpenDirectory(parent);
+    if (!dir) return paths;
+    while (const char *entry = gSystem->GetDirEntry(dir)) {
+      TString name = entry;
+      if (name != "." && name != ".." && name.Index(wildcard) != kNPOS) {
+        paths.push_back(parent + "/" + name);
+      }
+    }
+    gSystem->FreeDirectory(dir);
+
+    sort(paths.begin(), paths.end());
+    return paths;
+
+  }
+
+  //! Local copy of source, or source itself if staging is disabled or fails
+  TString resolve(TString source) {
+
+    if (!enabled()) return source;
+
+    Long64_t sourceSize; long sourceTime;
+    if (!statFile(source, sourceSize, sourceTime)) {
+      return source; // Left for the reader to report
+    }
+
+    TString entry = entryPath(source);
+
+    // Shared for the whole job: protects the copy from eviction, other jobs can use it at the same time
+    int lock = openLock(entry + ".lock");
+    if (lock < 0 || flock(lock, LOCK_SH) != 0) {
+      if (lock >= 0) close(lock);
+      failures++;
+      return source;
+    }
+
+    bool valid = isValid(entry, sourceSize, sourceTime);
+    if (valid) {
+      hits++;
+    } else {
+      // One copier per file, the others wait here and find the copy valid on the second check
+      int copyLock = openLock(entry + ".copy");
+      if (copyLock >= 0 && flock(copyLock, LOCK_EX) == 0) {
+        valid = isValid(entry, sourceSize, sourceTime);
+        if (valid) {
+          hits++;
+        } else {
+          reserve(sourceSize, entry);
+          valid = copy(source, entry, sourceSize, sourceTime);
+          if (valid) copies++;
+        }
+      }
+      if (copyLock >= 0) close(copyLock);
+    }
+
+    if (!valid) {
+      close(lock);
+      failures++;
+      return source;
+    }
+
+    // Most recently used, and protected from eviction while this job runs
+    utime(entry.Data(), 0);
+    heldLocks.push_back(lock);
+
+    return entry;
+
+  }
+
+  //! Resolve a list of paths in place (stages everything ahead of the loop)
+  void stage(vector<TString> &paths) {
+    for (auto &path : paths) path = resolve(path);
+    if (enabled()) {
+      cout << "Stage cache " << directory << ": " << hits << " hits, " << copies << " copies, " << failures << " direct reads" << endl;
+    }
+  }
+
+  //! Cache entry of a source path
+  TString entryPath(TString source) {
+    TMD5 md5;
+    md5.Update((const UChar_t*)source.Data(), source.Length());
+    md5.Final();
+    return TString::Format("%s/%s_%s", directory.Data(), md5.AsString(), gSystem->BaseName(source));
+  }
+
+  static bool statFile(TString path, Long64_t &size, long &mtime) {
+    struct stat info;
+    if (stat(path.Data(), &info) != 0 || !S_ISREG(info.st_mode)) return false;
+    size  = info.st_size;
+    mtime = info.st_mtime;
+    return true;
+  }
+
+  static int openLock(TString path) {
+    return open(path.Data(), O_RDWR | O_CREAT, 0664);
+  }
+
+  //! Meta matches the source and the copy is complete (and unchanged, if verifying hits)
+  bool isValid(TString entry, Long64_t sourceSize, long sourceTime) {
+
+    Long64_t size; long mtime; string checksum;
+    ifstream meta((entry + ".meta").Data());
+    if (!(meta >> size >> mtime >> checksum)) return false;
+    if (size != sourceSize || mtime != sourceTime) return false;
+
+    Long64_t entrySize; long entryTime;
+    if (!statFile(entry, entrySize, entryTime) || entrySize != sourceSize) return false;
+
+    if (verifyHits) {
+      TMD5 *md5 = TMD5::FileChecksum(entry);
+      bool same = md5 && checksum == md5->AsString();
+      delete md5;
+      if (!same) {
+        cout << "Stage cache: checksum mismatch for " << entry << ", copying again" << endl;
+        return false;
+      }
+    }
+
+    return true;
+
+  }
+
+  //! Copy through a .part file, verify the written bytes and publish the copy with its meta
+  bool copy(TString source, TString entry, Long64_t sourceSize, long sourceTime) {
+
+    TString part = entry + ".part";
+    unlink((entry + ".meta").Data());
+
+    ifstream input(source.Data(), ios::binary);
+    ofstream output(part.Data(), ios::binary | ios::trunc);
+    if (!input || !output) return false;
+
+    vector<char> buffer(8 << 20);
+    TMD5 md5;
+    Long64_t copied = 0;
+    while (input) {
+      input.read(buffer.data(), buffer.size());
+      streamsize n = input.gcount();
+      if (n <= 0) break;
+      md5.Update((const UChar_t*)buffer.data(), n);
+      output.write(buffer.data(), n);
+      copied += n;
+    }
+    output.close();
+    md5.Final();
+
+    // Compare what landed on local disk with what was read from the source
+    bool good = !output.fail() && copied == sourceSize;
+    if (good) {
+      TMD5 *written = TMD5::FileChecksum(part);
+      good = written && *written == md5;
+      delete written;
+    }
+    if (!good || rename(part.Data(), entry.Data()) != 0) {
+      cout << "Stage cache: copy of " << source << " failed, reading it directly" << endl;
+      unlink(part.Data());
+      return false;
+    }
+
+    ofstream meta((entry + ".meta").Data());
+    meta << sourceSize << " " << sourceTime << " " << md5.AsString() << endl;
+    return meta.good();
+
+  }
+
+  //! Evict least recently used copies until incoming bytes fit under the size cap
+  void reserve(Long64_t incoming, TString keep) {
+
+    int lock = openLock(directory + "/.evict.lock");
+    if (lock < 0) return;
+    flock(lock, LOCK_EX);
+
+    // Copies in the cache, by last use
+    vector<pair<long, TString>> entries;
+    Long64_t total = 0;
+    void *dir = gSystem->OpenDirectory(directory);
+    while (dir) {
+      const char *name = gSystem->GetDirEntry(dir);
+      if (!name) break;
+      TString meta = name;
+      if (!meta.EndsWith(".meta")) continue;
+      TString entry = directory + "/" + meta(0, meta.Length() - 5);
+      Long64_t size; long mtime;
+      if (entry != keep && statFile(entry, size, mtime)) {
+        entries.push_back({ mtime, entry });
+        total += size;
+      }
+    }
+    if (dir) gSystem->FreeDirectory(dir);
+    sort(entries.begin(), entries.end());
+
+    for (auto &candidate : entries) {
+      if (total + incoming <= sizeLimit) break;
+
+      // Skip copies that are being written or read by a job
+      int entryLock = openLock(candidate.second + ".lock");
+      if (entryLock < 0) continue;
+      if (flock(entryLock, LOCK_EX | LOCK_NB) == 0) {
+        Long64_t size; long mtime;
+        if (statFile(candidate.second, size, mtime)) total -= size;
+        unlink((candidate.second + ".meta").Data());
+        unlink(candidate.second.Data());
+        unlink((candidate.second + ".part").Data());
+      }
+      close(entryLock);
+    }
+
+    if (total + incoming > sizeLimit) {
+      cout << "Stage cache over its cap (" << (total + incoming) / 1e9 << " GB), all older copies are in use" << endl;
+    }
+
+    close(lock);
+
+  }
+
+};
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef __TimeIndex_h__
+#define __TimeIndex_h__
+
+#include "TFile.h"
+#include "TNamed.h"
+#include "TString.h"
+#include "TSystem.h"
+#include "TTree.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "Ntp.h"
+
+using namespace std;
+
+/** \file TimeIndex.h
+Per-file index from utime to Compact entry ranges, built from the SHeader branch alone.
+The index of <run>.root is kept in <index directory>/<run>.index.root: a TimeIndex tree with one row
+per run of consecutive entries sharing a second (utime, first, last) and a "source" TNamed with the
+size and mtime of the run file it was built from. A stale, missing or unreadable index is rebuilt on first
+use; every job writes its own temporary file, so jobs indexing the same run file do not collide.
+*/
+
+/** \class TimeIndexRow
+Consecutive Compact entries sharing a second.
+*/
+class TimeIndexRow {
+
+ public:
+
+  unsigned int utime;  ///< JMDC unix time [s]
+  Long64_t     first;  ///< First entry of the second
+  Long64_t     last;   ///< Last entry of the second
+
+};
+
+/** \class TimeIndex
+Builds, loads and queries the time index of run files.
+*/
+class TimeIndex {
+
+ public:
+
+  TString directory;  ///< Directory with the index files
+
+  TimeIndex(TString indexDirectory) {
+    directory = indexDirectory;
+    gSystem->mkdir(directory, kTRUE);
+  }
+
+  //! Index file of a run file
+  TString indexPath(TString runFile) {
+    TString name = gSystem->BaseName(runFile);
+    name.ReplaceAll(".root", "");
+    return Form("%s/%s.index.root", directory.Data(), name.Data());
+  }
+
+  //! Size and mtime of the run file, as stored in the index
+  TString sourceStamp(TString runFile) {
+    FileStat_t info;
+    if (gSystem->GetPathInfo(runFile, info) != 0) return "";
+    return Form("%lld %ld", info.fSize, info.fMtime);
+  }
+
+  //! Read only SHeader.utime of every Compact entry into (utime, first, last) rows
+  bool scan(TString runFile, vector<TimeIndexRow> &rows) {
+
+    TFile *input = TFile::Open(runFile);
+    if (!input || input->IsZombie()) {
+      delete input;
+      return false;
+    }
+    TTree *tree = (TTree*)input->Get("Compact");
+    if (!tree) {
+      delete input;
+      return false;
+    }
+
+    NtpSHeader *header = new NtpSHeader();
+    tree->SetBranchStatus("*", 0);
+    tree->SetBranchStatus("SHeader*", 1);
+    tree->SetBranchStatus("utime", 1);
+    tree->SetBranchAddress("SHeader", &header);
+
+    rows.clear();
+    Long64_t entries = tree->GetEntries();
+    for (Long64_t i=0; i < entries; i++) {
+      tree->GetEntry(i);
+      if (i > 0 && header->utime == rows.back().utime) {
+        rows.back().last = i;
+        continue;
+      }
+      rows.push_back({ header->utime, i, i });
+    }
+
+    delete input;
+    delete header;
+    return true;
+
+  }
+
+  //! Store the rows of runFile in its index file, through a temporary file of this process
+  bool build(TString runFile, vector<TimeIndexRow> &rows) {
+
+    if (!scan(runFile, rows)) return false;
+
+    TString part = Form("%s.%d.part", indexPath(runFile).Data(), gSystem->GetPid());
+    TFile *output = TFile::Open(part, "recreate");
+    if (!output || output->IsZombie()) {
+      delete output;
+      return false;
+    }
+    TTree *index = new TTree("TimeIndex", "Compact entry range per second");
+    TimeIndexRow row;
+    index->Branch("utime", &row.utime, "utime/i");
+    index->Branch("first", &row.first, "first/L");
+    index->Branch("last", &row.last, "last/L");
+    for (auto &stored : rows) {
+      row = stored;
+      index->Fill();
+    }
+
+    TNamed source("source", sourceStamp(runFile));
+    output->cd();
+    index->Write();
+    source.Write();
+    delete output;
+
+    if (gSystem->Rename(part, indexPath(runFile)) == 0) return true;
+    gSystem->Unlink(part);
+    return false;
+
+  }
+
+  //! Rows of a valid index file of runFile, false if it is missing, stale or unreadable
+  bool load(TString runFile, vector<TimeIndexRow> &rows) {
+
+    TString path = indexPath(runFile);
+    TString stamp = sourceStamp(runFile);
+    TFile *file = gSystem->AccessPathName(path) ? 0 : TFile::Open(path);
+    TNamed *source = file ? (TNamed*)file->Get("source") : 0;
+    TTree *index   = file ? (TTree*)file->Get("TimeIndex") : 0;
+    if (!source || !index || (stamp.Length() > 0 && stamp != source->GetTitle())) {
+      delete file;
+      return false;
+    }
+
+    TimeIndexRow row;
+    index->SetBranchAddress("utime", &row.utime);
+    index->SetBranchAddress("first", &row.first);
+    index->SetBranchAddress("last", &row.last);
+    rows.clear();
+    for (Long64_t i=0; i < index->GetEntries(); i++) {
+      index->GetEntry(i);
+      rows.push_back(row);
+    }
+
+    delete file;
+    return true;
+
+  }
+
+  //! Entry ranges [first, last] of runFile with t0 <= utime < t1, adjacent rows merged
+  vector<pair<Long64_t, Long64_t>> entryRanges(TString runFile, unsigned int t0, unsigned int t1) {
+    return entryRanges(runFile, [t0, t1](unsigned int utime) { return utime >= t0 && utime < t1; });
+  }
+
+  //! Entry ranges [first, last] of runFile for the seconds accepted by keep(utime), adjacent rows merged
+  vector<pair<Long64_t, Long64_t>> entryRanges(TString runFile, std::function<bool(unsigned int)> keep) {
+
+    vector<pair<Long64_t, Long64_t>> ranges;
+
+    // Build on first use, rebuild when the run file changed or the index is unreadable; if the index
+    // cannot be written the rows of this job's own scan are used
+    vector<TimeIndexRow> rows;
+    if (!load(runFile, rows) && !build(runFile, rows) && rows.empty()) {
+      cout << "Could not index " << runFile << endl;
+      return ranges;
+    }
+
+    for (auto &row : rows) {
+      if (!keep(row.utime)) continue;
+      if (!ranges.empty() && ranges.back().second + 1 == row.first) {
+        ranges.back().second = row.last;
+      } else {
+        ranges.push_back({ row.first, row.last });
+      }
+    }
+
+    return ranges;
+
+  }
+
+};
+
+#endif
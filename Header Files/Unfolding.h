@@ -0,0 +1,84 @@
+#ifndef __Unfolding_h__
+#define __Unfolding_h__
+
+#include <vector>
+
+using namespace std;
+
+/** \file Unfolding.h
+Iterative Bayesian (D'Agostini) unfolding of the rigidity migration, on plain bin contents.
+The response is the HistMaker montecarloResponse (selected MC events, generated vs reconstructed rigidity)
+divided by montecarloGenerated, so P(j|i) is the probability that an event generated in true bin i is selected
+in reconstructed bin j. It is normalised once and shared (read only) by every zone that is unfolded with it.
+True bins include the generated under- and overflow (events from outside the range migrating into it).
+For a diagonal response one iteration gives back measured / (selected / generated), the bin-by-bin result.
+*/
+
+/** \class UnfoldingResponse
+Normalised migration matrix and the unfolding that uses it.
+*/
+class UnfoldingResponse {
+
+ public:
+
+  int            trueNumber;    ///< True bins (range plus under- and overflow)
+  int            recoNumber;    ///< Reconstructed bins
+  vector<double> probability;   ///< P(j|i): [i * recoNumber + j]
+
+  //! response[i * recoNumber + j] selected events, generated[i] generated events of true bin i
+  UnfoldingResponse(int trueBins, int recoBins, const double *response, const double *generated) {
+    trueNumber = trueBins;
+    recoNumber = recoBins;
+    probability.assign(trueNumber * recoNumber, 0);
+    for (int i=0; i < trueNumber; i++) {
+      if (generated[i] <= 0) continue;
+      for (int j=0; j < recoNumber; j++) probability[i * recoNumber + j] = response[i * recoNumber + j] / generated[i];
+    }
+  }
+
+  //! Unfold measured[j] (variance[j]) starting from prior[i], into unfolded[i] (unfoldedVariance[i])
+  /** Reconstructed bins with measured[j] < 0 are not measured (no exposure) and are left out, the efficiency of a
+      true bin is then the probability to end up in a measured bin. True bins without efficiency get zero. The
+      variance is propagated through the last unfolding matrix, ignoring its own dependence on the data.
+   */
+  void unfold(const double *measured, const double *variance, const double *prior, int iterations,
+              double *unfolded, double *unfoldedVariance) const {
+
+    vector<double> efficiency(trueNumber, 0), estimate(trueNumber, 0), folded(recoNumber, 0);
+    for (int i=0; i < trueNumber; i++) {
+      for (int j=0; j < recoNumber; j++) {
+        if (measured[j] >= 0) efficiency[i] += probability[i * recoNumber + j];
+      }
+      estimate[i] = efficiency[i] > 0 ? prior[i] : 0;
+    }
+
+    for (int iteration=0; iteration < iterations; iteration++) {
+
+      // Expected measurement of the current estimate
+      for (int j=0; j < recoNumber; j++) {
+        folded[j] = 0;
+        for (int i=0; i < trueNumber; i++) folded[j] += probability[i * recoNumber + j] * estimate[i];
+      }
+
+      // Bayes: share every measured bin over the true bins, in proportion to what they contribute to it
+      bool last = iteration == iterations - 1;
+      for (int i=0; i < trueNumber; i++) {
+        unfolded[i] = 0;
+        unfoldedVariance[i] = 0;
+        if (efficiency[i] <= 0) continue;
+        for (int j=0; j < recoNumber; j++) {
+          if (measured[j] < 0 || folded[j] <= 0) continue;
+          double share = probability[i * recoNumber + j] * estimate[i] / folded[j] / efficiency[i];
+          unfolded[i] += share * measured[j];
+          if (last) unfoldedVariance[i] += share * share * variance[j];
+        }
+      }
+      for (int i=0; i < trueNumber; i++) estimate[i] = unfolded[i];
+
+    }
+
+  }
+
+};
+
+#endif
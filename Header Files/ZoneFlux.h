@@ -0,0 +1,164 @@
+#ifndef __ZoneFlux_h__
+#define __ZoneFlux_h__
+
+#include "TFile.h"
+#include "TH1F.h"
+#include "TMath.h"
+
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+/** \file ZoneFlux.h
+Proton flux of a single time zone, computed from the ZoneLooper and HistMaker histograms on plain bin contents.
+The one implementation of the flux: GraphLooper draws the terms, the other stages use the flux itself.
+*/
+
+//! Acceptance radius used by GraphLooper [m]
+const double zoneFluxRadius = 3.9;
+
+//! Zone histograms used by the flux, in the order of the count arrays of fluxTerms()
+const char *zoneFluxHistograms[10]  = { "exposureTime", "eventsSelected", "triggersPhysical", "triggersBias",
+                                        "baseTracker", "baseTOF", "cutParticle", "cutBeta", "cutChiSquared", "cutInnerLayer" };
+//! HistMaker histograms used by the flux, in the same order
+const char *zoneFluxMonteCarlo[10]  = { "montecarloGenerated", "montecarloSelected", "montecarloPhysical", "montecarloBias",
+                                        "montecarloTracker", "montecarloTOF", "montecarloParticle", "montecarloBeta",
+                                        "montecarloChiSquared", "montecarloInnerLayer" };
+
+//! Corrections applied by fluxTerms() (all of them in GraphLooper)
+enum ZoneFluxCorrection {
+  kFluxTrigger    = 0x01,  ///< Data / MC trigger efficiency
+  kFluxParticle   = 0x02,  ///< Data / MC particle-like efficiency (TOF base)
+  kFluxBeta       = 0x04,  ///< Data / MC beta efficiency (TOF base)
+  kFluxChiSquared = 0x08,  ///< Data / MC chi squared efficiency (TRK base)
+  kFluxInnerLayer = 0x10,  ///< Data / MC inner layer efficiency (TRK base)
+  kFluxAll        = 0x1F
+};
+
+/** \class FluxTerms
+Flux of one rigidity bin and the factors it is made of.
+*/
+class FluxTerms {
+
+ public:
+
+  double rate           = 0;  ///< Selected events / exposure / bin width
+  double rateError      = 0;
+  double acceptance     = 0;  ///< Geometric acceptance of the selection [m^2 sr]
+  double trigger        = 1;  ///< Data trigger efficiency
+  double mcTrigger      = 1;  ///< MC trigger efficiency
+  double triggerErr     = 0;
+  double mcTriggerErr   = 0;
+  double selection      = 1;  ///< Data selection efficiency (product of the applied cut efficiencies)
+  double mcSelection    = 1;  ///< MC selection efficiency
+  double flux           = 0;
+  double fluxError      = 0;
+
+};
+
+//! Cut efficiency num / den, 0 without a denominator (stored as float, like TH1F::Divide)
+double fluxRatio(double num, double den) {
+  return den != 0 ? (float)(num / den) : 0;
+}
+
+//! Geometric acceptance [m^2 sr] of selected out of generated MC events
+double fluxAcceptance(double selected, double generated) {
+  return TMath::Pi() * zoneFluxRadius * zoneFluxRadius * selected / generated;
+}
+
+//! Flux terms of bin i from the contents of the zone (h[k][i]) and MC (m[k][i]) histograms, see zoneFluxHistograms
+/** A bin without exposure gets a rate, flux and errors of zero; its acceptance and efficiencies are still computed
+    (and are NaN where a ratio has no counts). The contents may be sums over zones and merged bins, which is how
+    FluxStore.h answers time range and rebinning queries.
+ */
+FluxTerms fluxTerms(const double *const *h, const double *const *m, int i, double binWidth, int corrections = kFluxAll) {
+
+  FluxTerms terms;
+
+  double exposure  = h[0][i];
+  double selected  = h[1][i];
+  double physical  = h[2][i];
+  double bias      = h[3][i];
+
+  terms.acceptance = fluxAcceptance(m[1][i], m[0][i]);
+
+  if (corrections & kFluxTrigger) {
+    terms.trigger      = physical / (physical + 100 * bias);
+    terms.mcTrigger    = m[2][i] / (m[2][i] + m[3][i]);
+    terms.triggerErr   = 100 * TMath::Sqrt(physical * pow(bias, 2) + bias * pow(physical, 2)) / pow(physical + 100 * bias, 2);
+    terms.mcTriggerErr = TMath::Sqrt(physical * pow(bias, 2) + bias * pow(physical, 2)) / pow(physical + bias, 2);
+  }
+
+  // Selection efficiency (normalised by the corresponding instrument base)
+  double particle   = (corrections & kFluxParticle)   ? fluxRatio(h[6][i], h[5][i]) : 1;
+  double beta       = (corrections & kFluxBeta)       ? fluxRatio(h[7][i], h[5][i]) : 1;
+  double chiSquared = (corrections & kFluxChiSquared) ? fluxRatio(h[8][i], h[4][i]) : 1;
+  double innerLayer = (corrections & kFluxInnerLayer) ? fluxRatio(h[9][i], h[4][i]) : 1;
+  double mcParticle   = (corrections & kFluxParticle)   ? fluxRatio(m[6][i], m[5][i]) : 1;
+  double mcBeta       = (corrections & kFluxBeta)       ? fluxRatio(m[7][i], m[5][i]) : 1;
+  double mcChiSquared = (corrections & kFluxChiSquared) ? fluxRatio(m[8][i], m[4][i]) : 1;
+  double mcInnerLayer = (corrections & kFluxInnerLayer) ? fluxRatio(m[9][i], m[4][i]) : 1;
+
+  terms.selection   = particle * beta * chiSquared * innerLayer;
+  terms.mcSelection = mcParticle * mcBeta * mcChiSquared * mcInnerLayer;
+
+  if (exposure == 0) {
+    return terms;
+  }
+
+  terms.rate      = selected / exposure / binWidth;
+  terms.rateError = terms.rate / TMath::Sqrt(selected);
+
+  terms.flux = terms.rate / terms.acceptance / terms.trigger * terms.mcTrigger / terms.selection * terms.mcSelection;
+
+  terms.fluxError = terms.flux * TMath::Sqrt(1 / selected + pow(terms.triggerErr / terms.trigger, 2) + pow(terms.mcTriggerErr / terms.mcTrigger, 2));
+
+  return terms;
+
+}
+
+//! Fill terms[binNumber] for one zone, returns false if a histogram is missing
+/** The file histograms are only read, so the files can be reused for other zones. */
+bool zoneFluxTerms(TFile *histFile, TFile *mcFile, int binNumber, const double *binEdges, FluxTerms *terms) {
+
+  vector<vector<double>> hContents(10, vector<double>(binNumber)), mContents(10, vector<double>(binNumber));
+  const double *h[10]; const double *m[10];
+
+  for (int k=0; k < 10; k++) {
+    TH1F *hHist = histFile ? (TH1F*)histFile->Get(zoneFluxHistograms[k]) : 0;
+    TH1F *mHist = mcFile ? (TH1F*)mcFile->Get(zoneFluxMonteCarlo[k]) : 0;
+    if (!hHist || !mHist) return false;
+    for (int i=0; i < binNumber; i++) {
+      hContents[k][i] = hHist->GetBinContent(i + 1);
+      mContents[k][i] = mHist->GetBinContent(i + 1);
+    }
+    h[k] = hContents[k].data();
+    m[k] = mContents[k].data();
+  }
+
+  for (int i=0; i < binNumber; i++) {
+    terms[i] = fluxTerms(h, m, i, binEdges[i + 1] - binEdges[i]);
+  }
+
+  return true;
+
+}
+
+//! Fill flux[binNumber] and fluxErrors[binNumber] for one zone, returns false if a histogram is missing
+/** Bins without exposure get a flux and error of zero. */
+bool zoneFlux(TFile *histFile, TFile *mcFile, int binNumber, const double *binEdges, double *flux, double *fluxErrors) {
+
+  vector<FluxTerms> terms(binNumber);
+  if (!zoneFluxTerms(histFile, mcFile, binNumber, binEdges, terms.data())) return false;
+
+  for (int i=0; i < binNumber; i++) {
+    flux[i]       = terms[i].flux;
+    fluxErrors[i] = terms[i].fluxError;
+  }
+
+  return true;
+
+}
+
+#endif
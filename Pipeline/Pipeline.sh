@@ -0,0 +1,8 @@
+#!/bin/bash
+
+export ROOTSYS=/cvmfs/sft.cern.ch/lcg/app/releases/ROOT/6.20.08/x86_64-centos7-gcc48-opt
+source $ROOTSYS/bin/thisroot.sh
+
+# Stages call root themselves, run from the Pipeline directory
+cd "$(dirname "$0")"
+root -b -q 'Pipeline.C('$1')'
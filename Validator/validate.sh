@@ -0,0 +1,35 @@
+#!/bin/bash
+
+# A/B comparison of the reference ZoneLooper against a candidate loop on the same run files
+# Usage :: ./validate.sh <files.txt|synthetic> [candidate call] [output directory]
+# The candidate call may use $LIST and $OUTPUT, e.g.
+#   ./validate.sh files.txt '../ZoneLooper/ZoneLooper.C(-1, 0, "$LIST", "$OUTPUT")'
+
+LIST=$1
+CANDIDATE=${2:-'../ZoneLooper/ZoneLooper.C(-1, 0, "$LIST", "$OUTPUT")'}
+WORK=${3:-validation}
+
+mkdir -p $WORK
+
+# Synthetic input set
+if [ "$LIST" == "synthetic" ]; then
+    root -b -q "Synthetic.C(\"$WORK/synthetic\", 4)" > $WORK/synthetic.log 2>&1
+    LIST=$WORK/synthetic/files.txt
+fi
+
+rm -f $WORK/timing.txt
+
+# Reference
+OUTPUT=$WORK/reference.root
+/usr/bin/time -f "reference %e %M" -a -o $WORK/timing.txt \
+    root -b -q "Reference/ZoneLooperReference.C(\"$LIST\", \"$OUTPUT\")" > $WORK/reference.log 2>&1
+
+# Candidate
+OUTPUT=$WORK/candidate.root
+CALL=${CANDIDATE//\$LIST/$LIST}
+CALL=${CALL//\$OUTPUT/$OUTPUT}
+/usr/bin/time -f "candidate %e %M" -a -o $WORK/timing.txt \
+    root -b -q "$CALL" > $WORK/candidate.log 2>&1
+
+# Comparison
+root -b -q "Validator.C(\"$WORK/reference.root\", \"$WORK/candidate.root\", \"$WORK/timing.txt\", \"$WORK/report.txt\")"